@@ -1,41 +1,55 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
 
 #include "Acceptor.h"
 #include "Logger.h"
 #include "Channel.h"
 #include "InetAddress.h"
 
-static int createNonblocking()
+Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)
+    : loop_(loop),
+      acceptSocket_(Socket::createNonblocking(listenAddr.family())),
+      acceptChaneel_(loop, acceptSocket_.fd()),
+      listenning_(false),
+      acceptBatchSize_(kDefaultAcceptBatchSize),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
-    /* 创建TCP套接字 */
-    int sockfd = ::socket(AF_INET,
-                          SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
-                          IPPROTO_TCP);
-    if (sockfd < 0)
+    if (listenAddr.isUnix())
+    {
+        /* Unix域套接字不支持SO_REUSEPORT，上次运行留下的套接字文件会导致bind()失败 */
+        std::string path = listenAddr.toUnixPath();
+        if (!path.empty() && path[0] != '@')
+        {
+            ::unlink(path.c_str());
+        }
+    }
+    else
     {
-        LOG_ERROR("socket() failed");
+        acceptSocket_.setReuseAddr(true);
+        acceptSocket_.setReusePort(reuseport);
     }
-    return sockfd;
+    acceptSocket_.bindAddress(listenAddr);
+    acceptChaneel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
-Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr)
+Acceptor::Acceptor(EventLoop *loop, int listenFd)
     : loop_(loop),
-      acceptSocket_(createNonblocking()),
+      acceptSocket_(listenFd),
       acceptChaneel_(loop, acceptSocket_.fd()),
       listenning_(false),
+      acceptBatchSize_(kDefaultAcceptBatchSize),
       idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.bindAddress(listenAddr);
     acceptChaneel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
 Acceptor::~Acceptor()
 {
     listenning_ = false;
-    Socket::close(acceptSocket_.fd());
+    /* acceptSocket_析构时会关闭监听套接字 */
     Socket::close(idleFd_);
 }
 
@@ -47,30 +61,79 @@ void Acceptor::listen()
     acceptChaneel_.enableReading();
 }
 
-void Acceptor::handleRead()
+void Acceptor::stop()
 {
     loop_->assertInLoopThread();
-    InetAddress peerAddr(0);
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    if (listenning_)
+    {
+        listenning_ = false;
+        acceptChaneel_.disableAll();
+        acceptChaneel_.remove();
+    }
+}
+
+void Acceptor::acceptPending(NewConnectionList *conns)
+{
+    loop_->assertInLoopThread();
+    acceptBatch(INT_MAX, conns);
+}
+
+void Acceptor::acceptBatch(int limit, NewConnectionList *conns)
+{
+    for (int i = 0; i < limit; i++)
     {
-        if (cb_)
+        InetAddress peerAddr(0);
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
         {
-            cb_(connfd, peerAddr);
+            conns->emplace_back(connfd, peerAddr);
+            continue;
         }
-        else
+        if (errno == EAGAIN) // 已完成连接队列已经取空
         {
-            Socket::close(acceptSocket_.fd());
+            break;
         }
-    }
-    else // 处理描述符耗尽的情况,启用该“备用”描述符，接收连接后再立刻关闭，然后又转为“备用”描述符
-    {
-        if (errno == EMFILE)
+        else if (errno == EMFILE) // 处理描述符耗尽的情况,启用该“备用”描述符，接收连接后再立刻关闭，然后又转为“备用”描述符
         {
             ::close(idleFd_);
             idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
             ::close(idleFd_);
             idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            break;
+        }
+        else if (errno != ECONNABORTED && errno != EINTR && errno != EPROTO)
+        {
+            break; // 其他错误(如EBADF)再试也不会成功
+        }
+        /* ECONNABORTED等只影响单个连接，继续取下一个 */
+    }
+}
+
+void Acceptor::handleRead()
+{
+    loop_->assertInLoopThread();
+    pendingConns_.clear();
+    acceptBatch(acceptBatchSize_, &pendingConns_);
+    if (pendingConns_.empty())
+    {
+        return;
+    }
+    if (batchCb_)
+    {
+        batchCb_(pendingConns_);
+    }
+    else
+    {
+        for (const auto &it : pendingConns_)
+        {
+            if (cb_)
+            {
+                cb_(it.first, it.second);
+            }
+            else
+            {
+                Socket::close(it.first);
+            }
         }
     }
 }
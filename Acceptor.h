@@ -1,11 +1,13 @@
 #pragma once
 #include <functional>
+#include <vector>
+#include <utility>
 
 #include "EventLoop.h"
+#include "InetAddress.h"
 #include "noncopyable.h"
 #include "Socket.h"
 
-class InetAddress;
 class Channel;
 
 /* 等待并处理到来的连接请求，然后创建连接 */
@@ -13,21 +15,42 @@ class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    using NewConnectionList = std::vector<std::pair<int, InetAddress>>;
+    /* 一次可读事件中accept到的所有连接，一并交给回调 */
+    using NewConnectionBatchCallback = std::function<void(const NewConnectionList &)>;
+    static const int kDefaultAcceptBatchSize = 32;
 
-    Acceptor(EventLoop *loop, const InetAddress &listenAddr);
+    /* reuseport为true时设置SO_REUSEPORT，多个Acceptor可以绑定同一地址，由内核分摊连接 */
+    Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport = false);
+    /* 接管一个已经bind(可能已经listen)的套接字，例如从旧进程移交过来的监听套接字 */
+    Acceptor(EventLoop *loop, int listenFd);
     ~Acceptor();
 
     void listen();
+    void stop(); // 停止accept但不关闭监听套接字，必须在loop线程中调用
+    /* 取出已完成连接队列中的所有连接，不经过回调直接交给调用者，通常在stop()之后、析构之前调用 */
+    void acceptPending(NewConnectionList *conns);
     bool listenning() { return listenning_; }
+    int fd() const { return acceptSocket_.fd(); }
+    EventLoop *getLoop() const { return loop_; }
     void setNewConnectionCallback(const NewConnectionCallback &cb) { cb_ = std::move(cb); } // 设置连接回调
+    /* 设置后优先于单个连接的回调 */
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback &cb) { batchCb_ = std::move(cb); }
+    /* 每次可读事件最多accept的连接数，剩下的留给下一轮poll，避免饿死其他Channel */
+    void setAcceptBatchSize(int n) { acceptBatchSize_ = n > 0 ? n : 1; }
 
 private:
-    void handleRead(); // 一旦有连接到达，就调用accept()建立连接，并调用连接回调
+    void handleRead(); // 一旦有连接到达，就反复accept()直到EAGAIN或达到批量上限，再调用连接回调
+    /* 最多accept limit个连接追加到conns，队列取空或描述符耗尽时提前返回 */
+    void acceptBatch(int limit, NewConnectionList *conns);
 
     bool listenning_;
     Socket acceptSocket_; // 接收连接请求的socket
     EventLoop *loop_;
     Channel acceptChaneel_;
     NewConnectionCallback cb_;
+    NewConnectionBatchCallback batchCb_;
+    int acceptBatchSize_;
+    NewConnectionList pendingConns_; // 复用的批量缓存，避免每次可读事件都分配
     int idleFd_;
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <assert.h>
+#include <chrono>
+
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval)
+    : flushInterval_(flushInterval),
+      running_(false),
+      basename_(basename),
+      rollSize_(rollSize),
+      thread_(std::bind(&AsyncLogging::threadFunc, this)),
+      started_(false),
+      currentBuffer_(new LogBuffer),
+      nextBuffer_(new LogBuffer),
+      flushRequested_(0),
+      flushed_(0)
+{
+    buffers_.reserve(16);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    buffers_.push_back(std::move(currentBuffer_));
+    if (nextBuffer_)
+    {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else
+    {
+        currentBuffer_.reset(new LogBuffer); // 很少发生，前端写得太快，两块缓冲都用完了
+    }
+    currentBuffer_->append(logline, len);
+    cond_.notify_one();
+}
+
+void AsyncLogging::start()
+{
+    assert(!running_);
+    running_ = true;
+    thread_.start();
+    /* 等后台线程备好交换缓冲后再返回，避免start()之后立即stop()时错过最后一次写入 */
+    std::unique_lock<std::mutex> lk(mutex_);
+    cond_.wait(lk, [this]()
+               { return started_; });
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        running_ = false;
+        cond_.notify_all();
+    }
+    thread_.join();
+}
+
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    const uint64_t ticket = ++flushRequested_;
+    cond_.notify_all();
+    flushedCond_.wait(lk, [this, ticket]()
+                      { return flushed_ >= ticket; });
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, false);
+    BufferPtr newBuffer1(new LogBuffer);
+    BufferPtr newBuffer2(new LogBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        started_ = true;
+        cond_.notify_all();
+    }
+
+    bool exiting = false;
+    while (!exiting)
+    {
+        assert(newBuffer1 && newBuffer1->length() == 0);
+        assert(newBuffer2 && newBuffer2->length() == 0);
+        assert(buffersToWrite.empty());
+        uint64_t flushTicket;
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            if (buffers_.empty() && running_ && flushRequested_ == flushed_)
+            {
+                cond_.wait_for(lk, std::chrono::seconds(flushInterval_));
+            }
+            /* 不论是否写满，当前缓冲也一并换出，保证日志最多延迟flushInterval秒落盘 */
+            exiting = !running_;
+            flushTicket = flushRequested_; // 此前提交的日志都在本批中
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        assert(!buffersToWrite.empty());
+        if (buffersToWrite.size() > kMaxPendingBuffers)
+        {
+            char buf[256];
+            int n = snprintf(buf, sizeof(buf), "[ERROR]%s : AsyncLogging dropped %zu log buffers\n",
+                             Timestamp::now().toFormattedString().c_str(), buffersToWrite.size() - 2);
+            fputs(buf, stderr);
+            output.append(buf, static_cast<size_t>(n));
+            buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.end());
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        /* 留下两块缓冲补充newBuffer1/newBuffer2，其余释放 */
+        if (buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+        if (!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2)
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        buffersToWrite.clear();
+        output.flush();
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            flushed_ = flushTicket;
+            flushedCond_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string.h>
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Thread.h"
+#include "noncopyable.h"
+
+/**
+ * 异步日志后端，双缓冲：
+ * -前端线程调用append()时只在锁内把日志行拷入当前缓冲(4MB)，写满后换上备用缓冲，不做任何IO；
+ * -后台线程每flushInterval秒或有缓冲写满时被唤醒，在锁内把写满的缓冲整体换出，再在锁外批量写入LogFile；
+ * -后台线程自备两块空缓冲用于交换，稳态下不分配内存；
+ * -前端产生日志的速度长期超过磁盘时，积压超过kMaxPendingBuffers块的部分直接丢弃并记录一行提示，
+ *  避免内存无限增长。
+ * 用法：
+ *   AsyncLogging log("/var/log/server", 512 * 1024 * 1024);
+ *   log.start();
+ *   Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+ *   Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log)); // LOG_FATAL在exit()前同步落盘
+ * 停止前应先把Logger的输出和刷新函数换回默认，stop()之后的日志会被丢弃
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    /* 线程安全，由前端线程调用 */
+    void append(const char *logline, size_t len);
+
+    void start();
+    void stop(); // 写完已提交的日志后退出后台线程
+    /* 同步等待后台线程写完此前提交的所有日志并刷新文件，不能在后台线程中调用 */
+    void flush();
+
+private:
+    /* 定长的日志缓冲，只能追加，写不下时由调用者换缓冲 */
+    class LogBuffer : noncopyable
+    {
+    public:
+        LogBuffer() : cur_(data_) {}
+
+        void append(const char *buf, size_t len)
+        {
+            memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+        const char *data() const { return data_; }
+        size_t length() const { return static_cast<size_t>(cur_ - data_); }
+        size_t avail() const { return static_cast<size_t>(data_ + sizeof(data_) - cur_); }
+        void reset() { cur_ = data_; }
+
+    private:
+        char data_[4 * 1024 * 1024];
+        char *cur_;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    static const size_t kMaxPendingBuffers = 25; // 约100MB
+
+    void threadFunc();
+
+    const int flushInterval_;
+    std::atomic<bool> running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool started_;      // 后台线程已经开始运行，由mutex_保护
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_; // 已写满、等待后台线程写入的缓冲
+    uint64_t flushRequested_; // flush()请求的序号，由mutex_保护
+    uint64_t flushed_;        // 后台线程已完成的flush()序号，由mutex_保护
+    std::condition_variable flushedCond_;
+};
@@ -0,0 +1,591 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "BinaryLogging.h"
+#include "LogFile.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+namespace
+{
+    /* 环中的一条记录：头部之后依次是各个参数，整条记录按8字节对齐 */
+    struct RecordHeader
+    {
+        uint32_t size;   // 含头部的总长度
+        uint16_t level;
+        uint16_t nargs;
+        const char *fmt; // 为空表示环尾的填充，消费者直接跳到环首
+        int64_t tick;    // readTick()的读数，由后台线程换算成时间
+    };
+    /* 每个参数：整数/浮点/指针的载荷固定8字节，字符串为len字节(对齐到8) */
+    struct ArgHeader
+    {
+        uint32_t type;
+        uint32_t len;
+    };
+
+    /* 前端只读TSC(约几纳秒)，gettimeofday的开销留给后台线程；非x86平台直接用微秒时间戳 */
+    inline int64_t readTick()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return static_cast<int64_t>(__rdtsc());
+#else
+        return Timestamp::now().microSecondsSinceEpoch();
+#endif
+    }
+
+    inline size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+    const char *levelName(int level)
+    {
+        switch (level)
+        {
+        case DEBUG:
+            return "[DEBUG]";
+        case INFO:
+            return "[INFO]";
+        case ERROR:
+            return "[ERROR]";
+        case FATAL:
+            return "[FATAL]";
+        default:
+            return "";
+        }
+    }
+
+    /* 用实例编号而不是地址识别本线程的环属于哪个BinaryLogging，避免新实例复用旧地址 */
+    std::atomic<uint64_t> g_nextId(1);
+    __thread uint64_t t_ownerId = 0;
+    __thread void *t_ring = nullptr;
+
+    size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t capacity = 4096;
+        while (capacity < n)
+        {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+}
+
+/**
+ * 单生产者单消费者的环形缓冲，容量为2的幂：
+ * -生产者的私有状态和tail_在一个缓存行，消费者的私有状态和head_在另一个缓存行；
+ * -生产者缓存一份head_，只有空间看似不够时才去读消费者的head_；
+ * -消费者每批只读一次tail_、写一次head_，不在每条记录上与生产者争抢缓存行；
+ * -一条记录不会跨越环尾，放不下时先写一条填充记录再从环首开始。
+ */
+class BinaryLogging::Ring : noncopyable
+{
+public:
+    explicit Ring(size_t capacity)
+        : capacity_(capacity),
+          mask_(capacity - 1),
+          buffer_(new char[capacity]),
+          cachedHead_(0),
+          pendingTail_(0),
+          tail_(0),
+          consumerHead_(0),
+          cachedTail_(0),
+          head_(0),
+          dead_(false)
+    {
+        assert((capacity & mask_) == 0);
+        memset(buffer_.get(), 0, capacity_); // 预先触发缺页，不让首轮写入在IO线程上缺页
+    }
+
+    /* 生产者：预留n字节(n已按8对齐)，空间不足返回空指针 */
+    char *reserve(size_t n)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t contiguous = capacity_ - (tail & mask_);
+        size_t need = contiguous < n ? contiguous + n : n;
+        if (tail + need - cachedHead_ > capacity_)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail + need - cachedHead_ > capacity_)
+            {
+                return nullptr;
+            }
+        }
+        if (contiguous < n)
+        {
+            RecordHeader *pad = reinterpret_cast<RecordHeader *>(buffer_.get() + (tail & mask_));
+            pad->size = static_cast<uint32_t>(contiguous);
+            if (contiguous >= sizeof(RecordHeader))
+            {
+                pad->fmt = nullptr;
+            }
+            tail += contiguous;
+        }
+        pendingTail_ = tail + n;
+        return buffer_.get() + (tail & mask_);
+    }
+    void commit() { tail_.store(pendingTail_, std::memory_order_release); }
+
+    /* 消费者：取一次生产者已提交的位置，之后的peek()/pop()只看这个快照 */
+    void refresh() { cachedTail_ = tail_.load(std::memory_order_acquire); }
+    const RecordHeader *peek()
+    {
+        while (consumerHead_ != cachedTail_)
+        {
+            const RecordHeader *rec = reinterpret_cast<const RecordHeader *>(buffer_.get() + (consumerHead_ & mask_));
+            size_t contiguous = capacity_ - (consumerHead_ & mask_);
+            /* 填充记录可能短到放不下完整的头部，用长度等于到环尾的距离来识别 */
+            if (rec->size == contiguous && (contiguous < sizeof(RecordHeader) || rec->fmt == nullptr))
+            {
+                consumerHead_ += contiguous;
+                continue;
+            }
+            return rec;
+        }
+        return nullptr;
+    }
+    void pop(const RecordHeader *rec) { consumerHead_ += rec->size; }
+    /* 把已处理的空间还给生产者 */
+    void publish() { head_.store(consumerHead_, std::memory_order_release); }
+    /* 生产者线程退出后不会再写，之前提交的记录对读到dead()的消费者可见 */
+    void markDead() { dead_.store(true, std::memory_order_release); }
+    bool dead() const { return dead_.load(std::memory_order_acquire); }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<char[]> buffer_;
+
+    alignas(64) size_t cachedHead_; // 生产者私有
+    size_t pendingTail_;            // 生产者私有
+    std::atomic<size_t> tail_;
+
+    alignas(64) size_t consumerHead_; // 消费者私有
+    size_t cachedTail_;               // 消费者私有
+    std::atomic<size_t> head_;
+
+    std::atomic<bool> dead_;
+};
+
+/* 线程局部的环持有者，线程退出或改写另一个实例时把原来的环标记为废弃 */
+class BinaryLogging::RingOwner : noncopyable
+{
+public:
+    RingOwner() = default;
+    ~RingOwner()
+    {
+        reset(nullptr);
+        t_ownerId = 0;
+        t_ring = nullptr;
+    }
+
+    void reset(std::shared_ptr<Ring> ring)
+    {
+        if (ring_)
+        {
+            ring_->markDead();
+        }
+        ring_ = std::move(ring);
+    }
+
+private:
+    std::shared_ptr<Ring> ring_;
+};
+
+std::atomic<BinaryLogging *> BinaryLogging::active_(nullptr);
+
+BinaryLogging::BinaryLogging(const std::string &basename, off_t rollSize, size_t ringSize, int flushInterval)
+    : basename_(basename),
+      rollSize_(rollSize),
+      ringSize_(roundUpPowerOfTwo(ringSize)),
+      id_(g_nextId.fetch_add(1)),
+      flushInterval_(flushInterval),
+      running_(false),
+      thread_(std::bind(&BinaryLogging::threadFunc, this)),
+      ticksPerUs_(1.0),
+      dropped_(0),
+      reportedDropped_(0)
+{
+}
+
+BinaryLogging::~BinaryLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void BinaryLogging::start()
+{
+    assert(!running_);
+#if defined(__x86_64__) || defined(__i386__)
+    /* 标定TSC频率，之后后台线程据此把记录中的tick换算成时间 */
+    int64_t tick0 = readTick();
+    int64_t us0 = Timestamp::now().microSecondsSinceEpoch();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int64_t tick1 = readTick();
+    int64_t us1 = Timestamp::now().microSecondsSinceEpoch();
+    ticksPerUs_ = static_cast<double>(tick1 - tick0) / static_cast<double>(us1 - us0);
+#endif
+    output_.reset(new LogFile(basename_, rollSize_, false, flushInterval_));
+    running_ = true;
+    thread_.start();
+    /* LOG_FATAL只同步写自己那一行，exit()之前借Logger的刷新函数把环中更早的日志也写出 */
+    Logger::instance().setFlush([this]()
+                                {
+                                    flush();
+                                    Logger::defaultFlush();
+                                });
+    active_.store(this, std::memory_order_release);
+}
+
+void BinaryLogging::stop()
+{
+    BinaryLogging *self = this;
+    if (active_.compare_exchange_strong(self, nullptr))
+    {
+        Logger::instance().setFlush(Logger::FlushFunc());
+    }
+    running_ = false;
+    thread_.join();
+}
+
+void BinaryLogging::flush()
+{
+    std::lock_guard<std::mutex> lk(drainMutex_);
+    if (output_)
+    {
+        drain(output_.get());
+        output_->flush();
+    }
+}
+
+BinaryLogging::Ring *BinaryLogging::threadRing()
+{
+    if (__builtin_expect(t_ownerId == id_, 1))
+    {
+        return static_cast<Ring *>(t_ring);
+    }
+    /* 本线程第一次写日志，注册一个新环，之后只在本线程访问t_ring */
+    std::shared_ptr<Ring> ring = std::make_shared<Ring>(ringSize_);
+    Ring *r = ring.get();
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        rings_.push_back(ring);
+    }
+    static thread_local RingOwner owner;
+    owner.reset(std::move(ring));
+    t_ownerId = id_;
+    t_ring = r;
+    return r;
+}
+
+void BinaryLogging::logArgs(int level, const char *fmt, Arg *args, int nargs)
+{
+    size_t size = sizeof(RecordHeader);
+    for (int i = 0; i < nargs; ++i)
+    {
+        if (args[i].type == kString)
+        {
+            const char *s = args[i].s ? args[i].s : "(null)";
+            args[i].s = s;
+            args[i].len = static_cast<uint32_t>(strnlen(s, kMaxStringArg));
+            size += sizeof(ArgHeader) + align8(args[i].len);
+        }
+        else
+        {
+            args[i].len = 8;
+            size += sizeof(ArgHeader) + 8;
+        }
+    }
+
+    Ring *ring = threadRing();
+    char *p = ring->reserve(size);
+    if (p == nullptr)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    RecordHeader *rec = reinterpret_cast<RecordHeader *>(p);
+    rec->size = static_cast<uint32_t>(size);
+    rec->level = static_cast<uint16_t>(level);
+    rec->nargs = static_cast<uint16_t>(nargs);
+    rec->fmt = fmt;
+    rec->tick = readTick();
+    p += sizeof(RecordHeader);
+    for (int i = 0; i < nargs; ++i)
+    {
+        ArgHeader *arg = reinterpret_cast<ArgHeader *>(p);
+        arg->type = args[i].type;
+        arg->len = args[i].len;
+        p += sizeof(ArgHeader);
+        if (args[i].type == kString)
+        {
+            memcpy(p, args[i].s, args[i].len);
+            p += align8(args[i].len);
+        }
+        else
+        {
+            memcpy(p, &args[i].u, 8);
+            p += 8;
+        }
+    }
+    ring->commit();
+}
+
+namespace
+{
+    /* 读取第i个参数，参数不足时返回空 */
+    const ArgHeader *nextArg(const char *&cursor, int &remaining)
+    {
+        if (remaining == 0)
+        {
+            return nullptr;
+        }
+        const ArgHeader *arg = reinterpret_cast<const ArgHeader *>(cursor);
+        cursor += sizeof(ArgHeader) + align8(arg->len);
+        remaining--;
+        return arg;
+    }
+
+    /* 用一个转换说明格式化一个参数，spec形如"%-08.3"(不含长度修饰和转换字符) */
+    int formatArg(char *out, size_t avail, std::string &spec, char conv, const ArgHeader *arg)
+    {
+        const char *payload = reinterpret_cast<const char *>(arg + 1);
+        size_t base = spec.size();
+        int n = 0;
+        switch (arg->type)
+        {
+        case BinaryLogging::kInt:
+        case BinaryLogging::kUint:
+        {
+            int64_t v;
+            memcpy(&v, payload, 8);
+            bool isInt = strchr("diouxXc", conv) != nullptr;
+            if (conv == 'c')
+            {
+                spec += 'c';
+                n = snprintf(out, avail, spec.c_str(), static_cast<int>(v));
+            }
+            else
+            {
+                spec += "ll";
+                spec += isInt ? conv : (arg->type == BinaryLogging::kInt ? 'd' : 'u');
+                n = snprintf(out, avail, spec.c_str(), static_cast<long long>(v));
+            }
+            break;
+        }
+        case BinaryLogging::kDouble:
+        {
+            double d;
+            memcpy(&d, payload, 8);
+            spec += strchr("eEfFgGaA", conv) ? conv : 'g';
+            n = snprintf(out, avail, spec.c_str(), d);
+            break;
+        }
+        case BinaryLogging::kPointer:
+        {
+            const void *ptr;
+            memcpy(&ptr, payload, 8);
+            spec += 'p';
+            n = snprintf(out, avail, spec.c_str(), ptr);
+            break;
+        }
+        case BinaryLogging::kString:
+        default:
+        {
+            if (spec.find('.') == std::string::npos)
+            {
+                /* 拷贝出来的字符串没有结尾的'\0'，用精度限定长度 */
+                spec += ".*s";
+                n = snprintf(out, avail, spec.c_str(), static_cast<int>(arg->len), payload);
+            }
+            else
+            {
+                /* 格式串自带精度时，先补上'\0'再按原样格式化 */
+                std::string str(payload, arg->len);
+                spec += 's';
+                n = snprintf(out, avail, spec.c_str(), str.c_str());
+            }
+            break;
+        }
+        }
+        spec.resize(base);
+        if (n < 0)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(n) < avail ? n : static_cast<int>(avail) - 1;
+    }
+
+    /* 把一条记录格式化成 "[LEVEL]time : msg\n"，返回长度 */
+    size_t formatRecord(const RecordHeader *rec, Timestamp time, char *line, size_t size)
+    {
+        const char *pre = levelName(rec->level);
+        size_t len = strlen(pre);
+        memcpy(line, pre, len);
+        len += time.formatTo(line + len);
+        memcpy(line + len, " : ", 3);
+        len += 3;
+
+        const size_t limit = size - 2; // 留出换行和'\0'
+        const char *cursor = reinterpret_cast<const char *>(rec + 1);
+        int remaining = rec->nargs;
+        std::string spec;
+        for (const char *f = rec->fmt; *f && len < limit; ++f)
+        {
+            if (*f != '%')
+            {
+                line[len++] = *f;
+                continue;
+            }
+            if (f[1] == '%')
+            {
+                line[len++] = '%';
+                ++f;
+                continue;
+            }
+            /* 标志、宽度、精度原样保留，长度修饰符丢弃，由参数的实际类型决定 */
+            spec = "%";
+            const char *c = f + 1;
+            while (*c && strchr("-+ #0123456789.", *c))
+            {
+                spec += *c++;
+            }
+            while (*c && strchr("hljztLq", *c))
+            {
+                ++c;
+            }
+            if (*c == '\0')
+            {
+                break;
+            }
+            const ArgHeader *arg = nextArg(cursor, remaining);
+            if (arg != nullptr)
+            {
+                len += formatArg(line + len, limit - len + 1, spec, *c, arg);
+            }
+            f = c;
+        }
+        if (len > limit)
+        {
+            len = limit;
+        }
+        line[len++] = '\n';
+        return len;
+    }
+}
+
+size_t BinaryLogging::drain(LogFile *output)
+{
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        for (const auto &ring : rings_)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    /* 以本批开始时刻为锚点，按标定的频率倒推每条记录的时间 */
+    const int64_t anchorTick = readTick();
+    const int64_t anchorUs = Timestamp::now().microSecondsSinceEpoch();
+    /* 先读废弃标记再取快照，快照就包含了废弃环的全部记录 */
+    std::vector<Ring *> deadRings;
+    for (Ring *ring : rings)
+    {
+        if (ring->dead())
+        {
+            deadRings.push_back(ring);
+        }
+        ring->refresh();
+    }
+
+    char line[kMaxStringArg + 256];
+    size_t count = 0;
+    for (;;)
+    {
+        /* 每次取各环队首中最早的一条，使同一批中不同线程的日志按时间交织 */
+        Ring *earliest = nullptr;
+        const RecordHeader *rec = nullptr;
+        for (Ring *ring : rings)
+        {
+            const RecordHeader *r = ring->peek();
+            if (r != nullptr && (rec == nullptr || r->tick < rec->tick))
+            {
+                earliest = ring;
+                rec = r;
+            }
+        }
+        if (rec == nullptr)
+        {
+            break;
+        }
+        Timestamp time(anchorUs - static_cast<int64_t>(static_cast<double>(anchorTick - rec->tick) / ticksPerUs_));
+        output->append(line, formatRecord(rec, time, line, sizeof(line)));
+        earliest->pop(rec);
+        if (++count % 1024 == 0)
+        {
+            /* 批次很大时中途归还空间，生产者不必等整批处理完 */
+            for (Ring *ring : rings)
+            {
+                ring->publish();
+            }
+        }
+    }
+    for (Ring *ring : rings)
+    {
+        ring->publish();
+    }
+    if (!deadRings.empty())
+    {
+        /* 废弃的环已经写完，从注册表中移除，持有者也已放手，环随之释放 */
+        std::lock_guard<std::mutex> lk(mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [&deadRings](const std::shared_ptr<Ring> &ring)
+                                    {
+                                        return std::find(deadRings.begin(), deadRings.end(), ring.get()) != deadRings.end();
+                                    }),
+                     rings_.end());
+    }
+
+    int64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reportedDropped_)
+    {
+        int n = snprintf(line, sizeof(line), "[ERROR]%s : BinaryLogging dropped %ld messages\n",
+                         Timestamp::now().toFormattedString().c_str(), dropped - reportedDropped_);
+        output->append(line, static_cast<size_t>(n));
+        reportedDropped_ = dropped;
+    }
+    return count;
+}
+
+void BinaryLogging::threadFunc()
+{
+    while (running_.load(std::memory_order_acquire))
+    {
+        /* 前端不做任何通知，后台有日志时连续处理，空闲时每毫秒轮询一次 */
+        size_t count;
+        {
+            std::lock_guard<std::mutex> lk(drainMutex_);
+            count = drain(output_.get());
+            if (count == 0)
+            {
+                output_->flush();
+            }
+        }
+        if (count == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    /* stop()之前提交的日志都已在环中 */
+    flush();
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Thread.h"
+#include "noncopyable.h"
+
+class LogFile;
+
+/**
+ * 二进制延迟格式化日志：
+ * -前端(IO线程)不做snprintf，只把格式串指针、时间戳和原始参数按类型标记拷入本线程独占的环形缓冲，
+ *  每个环只有一个生产者和一个消费者，提交时只有一次release写，不加锁；
+ * -时间戳只读TSC，后台线程按start()时标定的频率换算成时间；
+ * -后台线程轮询所有线程的环，按时间戳归并后再格式化成与Logger相同的文本行，批量写入LogFile；
+ * -环满时丢弃该条日志并计数，IO线程永不阻塞，后台线程会在日志中记录丢弃的条数。
+ * 格式串必须是字符串字面量(LOG_*宏的用法即是如此)，字符串参数会被拷贝，最长kMaxStringArg字节。
+ * 线程退出时它的环被标记为废弃，后台线程写完其中的日志后释放。
+ * start()之后LOG_DEBUG/INFO/ERROR自动走二进制路径，LOG_FATAL仍同步输出到Logger；
+ * start()同时接管Logger的刷新函数，LOG_FATAL在exit()之前先把各环中的日志同步写入文件，stop()时恢复默认。
+ * 对象必须比所有写日志的线程活得更久，通常在main()中创建
+ */
+class BinaryLogging : noncopyable
+{
+public:
+    enum ArgType : uint32_t
+    {
+        kInt,
+        kUint,
+        kDouble,
+        kString,
+        kPointer,
+    };
+    /* 前端参数的中间表示，字符串只保存指针和长度，拷贝在写入环时完成 */
+    struct Arg
+    {
+        uint32_t type;
+        uint32_t len;
+        union
+        {
+            int64_t i;
+            uint64_t u;
+            double d;
+            const void *p;
+            const char *s;
+        };
+    };
+
+    static const size_t kMaxStringArg = 1024;
+    static const size_t kDefaultRingSize = 1 << 20; // 每个线程1MB
+
+    BinaryLogging(const std::string &basename, off_t rollSize, size_t ringSize = kDefaultRingSize,
+                  int flushInterval = 3);
+    ~BinaryLogging();
+
+    void start(); // 启动后台线程并成为LOG_*的二进制后端
+    void stop();  // 不再接收新日志，写完环中剩余的日志后退出
+    /* 在调用线程上同步写出各环中已提交的日志并刷新文件，可与后台线程并发调用 */
+    void flush();
+
+    /* 当前的二进制后端，没有时为空 */
+    static BinaryLogging *active() { return active_.load(std::memory_order_acquire); }
+
+    template <typename... Args>
+    void log(int level, const char *fmt, const Args &...args)
+    {
+        Arg argv[sizeof...(Args) + 1] = {toArg(args)...};
+        logArgs(level, fmt, argv, static_cast<int>(sizeof...(Args)));
+    }
+
+    int64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    class Ring;
+    class RingOwner;
+
+    static Arg toArg(const char *s)
+    {
+        Arg a;
+        a.type = kString;
+        a.s = s;
+        return a;
+    }
+    static Arg toArg(const std::string &s) { return toArg(s.c_str()); }
+    static Arg toArg(double d)
+    {
+        Arg a;
+        a.type = kDouble;
+        a.d = d;
+        return a;
+    }
+    static Arg toArg(float f) { return toArg(static_cast<double>(f)); }
+    template <typename T>
+    static Arg toArg(const T *p)
+    {
+        Arg a;
+        a.type = kPointer;
+        a.p = p;
+        return a;
+    }
+    /* 整数和枚举按有无符号分别扩展到64位 */
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, Arg>::type
+    toArg(T v)
+    {
+        Arg a;
+        if (std::is_signed<T>::value || std::is_enum<T>::value)
+        {
+            a.type = kInt;
+            a.i = static_cast<int64_t>(v);
+        }
+        else
+        {
+            a.type = kUint;
+            a.u = static_cast<uint64_t>(v);
+        }
+        return a;
+    }
+
+    void logArgs(int level, const char *fmt, Arg *args, int nargs);
+    Ring *threadRing();
+
+    void threadFunc();
+    /* 按时间戳归并所有环中已提交的记录并写入output，返回处理的条数，调用者持有drainMutex_ */
+    size_t drain(LogFile *output);
+
+    static std::atomic<BinaryLogging *> active_;
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const size_t ringSize_; // 向上取整到2的幂
+    const uint64_t id_;
+    const int flushInterval_;
+    std::atomic<bool> running_;
+    Thread thread_;
+    std::mutex mutex_; // 保护rings_的注册和回收
+    std::vector<std::shared_ptr<Ring>> rings_;
+    double ticksPerUs_; // start()时标定，之后只读
+    std::atomic<int64_t> dropped_;
+    std::mutex drainMutex_;          // 每个环只能有一个消费者，串行化后台线程和flush()
+    std::unique_ptr<LogFile> output_; // 由drainMutex_保护
+    int64_t reportedDropped_;         // 由drainMutex_保护
+};
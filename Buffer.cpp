@@ -32,7 +32,7 @@ void Buffer::makeSpace(size_t len)
 {
     if (len + kCheapPrepend > writableBytes() + prependableBytes())
     {
-        buffer_.resize(writableBytes() + len);
+        buffer_.resize(writeIndex_ + len); // 新数据追加在writeIndex_之后，扩容后必须放得下writeIndex_ + len
     }
     /* 如果原缓冲区的空闲空间足够储存，就挪移待发送数据 */
     else
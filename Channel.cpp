@@ -15,6 +15,8 @@ Channel::Channel(EventLoop *loop, int fd)
       events_(0),
       revents_(0),
       index_(-1),
+      polledEvents_(kNonEvent),
+      pendingUpdate_(false),
       tied_(false),
       eventHandling_(false)
 {
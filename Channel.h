@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 
 #include "noncopyable.h"
 
@@ -53,6 +54,12 @@ public:
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
 
+    /* 供EventLoop合并同一轮循环内的多次监听修改 */
+    bool pendingUpdate() const { return pendingUpdate_; }
+    void set_pendingUpdate(bool pending) { pendingUpdate_ = pending; }
+    int polledEvents() const { return polledEvents_; } // poller当前实际监听的事件
+    void set_polledEvents(int events) { polledEvents_ = events; }
+
     EventLoop *ownerLoop() { return loop_; }
 
     void handleEvent(Timestamp receiveTime); // 调用handleEvent()对特定的活跃描述符检查每一个poll事件，然后执行回调
@@ -77,7 +84,7 @@ public:
     void remove();
 
 private:
-    void update(); // 通过EventLoop间接调用Poller来修改Channel
+    void update(); // 通过EventLoop登记修改，在下一次poll前统一交给Poller
     void handleEventWithGuard(Timestamp receiveTime);
 
     static const int kNonEvent;
@@ -89,6 +96,8 @@ private:
     int events_;
     int revents_;
     int index_;
+    int polledEvents_;
+    bool pendingUpdate_;
     bool eventHandling_;
     bool tied_;
     std::weak_ptr<void> tie_;
@@ -0,0 +1,268 @@
+#include <assert.h>
+
+#include "ComputePool.h"
+#include "EventLoop.h"
+#include "Thread.h"
+#include "Timestamp.h"
+
+namespace
+{
+    /* 当前线程所属的计算线程池和下标，任务中再提交时优先放进自己的队列 */
+    __thread ComputePool *t_pool = nullptr;
+    __thread int t_workerIndex = -1;
+}
+
+struct ComputePool::Worker
+{
+    explicit Worker(const Thread::threadFunction &func)
+        : thread(func),
+          executed(0),
+          stolen(0),
+          busyUs(0)
+    {
+    }
+
+    Thread thread;
+    std::mutex mutex;
+    std::deque<Task> queue;
+    std::atomic<int64_t> executed;
+    std::atomic<int64_t> stolen;
+    std::atomic<int64_t> busyUs;
+};
+
+void ComputePool::Sequencer::complete(uint64_t id, const Functor &done)
+{
+    loop_->assertInLoopThread();
+    if (id != nextDeliver_)
+    {
+        ready_.emplace(id, done);
+        return;
+    }
+    if (done)
+    {
+        done();
+    }
+    ++nextDeliver_;
+    /* 前面的结果到齐了，依次执行后面已经完成的 */
+    for (auto it = ready_.begin(); it != ready_.end() && it->first == nextDeliver_; it = ready_.erase(it))
+    {
+        if (it->second)
+        {
+            it->second();
+        }
+        ++nextDeliver_;
+    }
+}
+
+ComputePool::ComputePool(int numThreads, size_t maxQueueSize)
+    : numThreads_(numThreads > 0 ? numThreads : 1),
+      maxQueueSize_(maxQueueSize > 0 ? maxQueueSize : 1),
+      running_(false),
+      next_(0),
+      pending_(0),
+      rejected_(0),
+      sleepers_(0)
+{
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        workers_.emplace_back(new Worker(std::bind(&ComputePool::workerFunc, this, i)));
+    }
+}
+
+ComputePool::~ComputePool()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void ComputePool::start()
+{
+    assert(!running_);
+    running_ = true;
+    for (auto &worker : workers_)
+    {
+        worker->thread.start();
+    }
+}
+
+void ComputePool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex_);
+        if (!running_)
+        {
+            return;
+        }
+        running_ = false;
+        cond_.notify_all();
+    }
+    /* push()在队列锁内检查running_，逐个加锁一遍之后不会再有任务入队 */
+    for (auto &worker : workers_)
+    {
+        std::lock_guard<std::mutex> lk(worker->mutex);
+    }
+    for (auto &worker : workers_)
+    {
+        worker->thread.join();
+    }
+    /* 与stop()竞争的提交可能在计算线程退出之后才入队，由调用者执行完 */
+    Task task;
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        while (popLocal(i, &task))
+        {
+            run(i, task);
+        }
+    }
+}
+
+bool ComputePool::submit(EventLoop *loop, const Work &work)
+{
+    return push(Task{work, loop, SequencerPtr(), 0});
+}
+
+bool ComputePool::submit(const SequencerPtr &sequencer, const Work &work)
+{
+    sequencer->loop_->assertInLoopThread();
+    if (!push(Task{work, sequencer->loop_, sequencer, sequencer->nextSubmit_}))
+    {
+        return false;
+    }
+    ++sequencer->nextSubmit_;
+    return true;
+}
+
+std::vector<ComputePool::WorkerStats> ComputePool::stats() const
+{
+    std::vector<WorkerStats> result;
+    for (const auto &worker : workers_)
+    {
+        WorkerStats s;
+        s.executed = worker->executed.load(std::memory_order_relaxed);
+        s.stolen = worker->stolen.load(std::memory_order_relaxed);
+        s.busyUs = worker->busyUs.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lk(worker->mutex);
+            s.queued = worker->queue.size();
+        }
+        result.push_back(s);
+    }
+    return result;
+}
+
+bool ComputePool::push(Task &&task)
+{
+    int start = (t_pool == this) ? t_workerIndex
+                                 : static_cast<int>(next_.fetch_add(1, std::memory_order_relaxed) % numThreads_);
+    bool pushed = false;
+    for (int i = 0; i < numThreads_ && !pushed; ++i)
+    {
+        Worker &worker = *workers_[(start + i) % numThreads_];
+        std::lock_guard<std::mutex> lk(worker.mutex);
+        if (!running_)
+        {
+            break; // 未启动或已经stop()，没有计算线程会再取走任务
+        }
+        if (worker.queue.size() < maxQueueSize_)
+        {
+            worker.queue.push_back(std::move(task));
+            pending_.fetch_add(1); // 在队列锁内计数，取走任务的线程减计数一定在这之后
+            pushed = true;
+        }
+    }
+    if (!pushed)
+    {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /* 先增加pending_再检查sleepers_，与等待方的顺序相反，两边至少有一方看到对方 */
+    if (sleepers_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex_);
+        cond_.notify_one();
+    }
+    return true;
+}
+
+bool ComputePool::popLocal(int index, Task *task)
+{
+    Worker &worker = *workers_[index];
+    std::lock_guard<std::mutex> lk(worker.mutex);
+    if (worker.queue.empty())
+    {
+        return false;
+    }
+    *task = std::move(worker.queue.front());
+    worker.queue.pop_front();
+    pending_.fetch_sub(1);
+    return true;
+}
+
+bool ComputePool::steal(int index, Task *task)
+{
+    for (int i = 1; i < numThreads_; ++i)
+    {
+        Worker &victim = *workers_[(index + i) % numThreads_];
+        std::lock_guard<std::mutex> lk(victim.mutex);
+        if (!victim.queue.empty())
+        {
+            /* 从队尾窃取，和队列主人取队头的位置错开 */
+            *task = std::move(victim.queue.back());
+            victim.queue.pop_back();
+            pending_.fetch_sub(1);
+            workers_[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ComputePool::run(int index, Task &task)
+{
+    Worker &worker = *workers_[index];
+    int64_t start = Timestamp::monotonicNow().microSecondsSinceEpoch();
+    Functor done = task.work();
+    worker.busyUs.fetch_add(Timestamp::monotonicNow().microSecondsSinceEpoch() - start,
+                            std::memory_order_relaxed);
+    worker.executed.fetch_add(1, std::memory_order_relaxed);
+
+    if (task.sequencer)
+    {
+        /* 即使没有回调也要投递，推进该Sequencer的顺序 */
+        task.loop->queueInLoop(std::bind(&Sequencer::complete, task.sequencer, task.id, std::move(done)));
+    }
+    else if (done)
+    {
+        task.loop->queueInLoop(done);
+    }
+}
+
+void ComputePool::workerFunc(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    while (true)
+    {
+        Task task;
+        if (popLocal(index, &task) || steal(index, &task))
+        {
+            run(index, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepMutex_);
+        sleepers_.fetch_add(1);
+        cond_.wait(lk, [this]()
+                   { return pending_.load() > 0 || !running_; });
+        sleepers_.fetch_sub(1);
+        if (!running_ && pending_.load() == 0)
+        {
+            break;
+        }
+    }
+    t_pool = nullptr;
+    t_workerIndex = -1;
+}
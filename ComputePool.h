@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "noncopyable.h"
+
+class EventLoop;
+
+/**
+ * 计算线程池，把解析、压缩、加解密等耗CPU的处理移出IO线程：
+ * -每个计算线程有自己的有界队列，从队头取任务；自己的队列空了就从其他线程的队尾窃取；
+ * -任务在计算线程中执行，返回的回调(可以为空)投递回提交时的EventLoop执行，在回调里再操作连接；
+ * -通过同一个Sequencer提交的任务可以并行执行，但结果按提交顺序回到loop，通常每个连接一个Sequencer；
+ * -所有队列都满时submit()返回false，由调用者决定拒绝请求、稍后重试还是暂停读取，IO线程不会被阻塞；
+ *  start()之前和stop()之后submit()同样返回false并计入rejected()，不会留下永远不执行的任务。
+ * 用法：
+ *   pool.submit(seq, [msg, conn]()
+ *               { std::string out = compress(msg);
+ *                 return [conn, out]() { conn->send(out); }; });
+ */
+class ComputePool : noncopyable
+{
+public:
+    using Functor = std::function<void()>;
+    /* 在计算线程中执行，返回要在loop中执行的回调 */
+    using Work = std::function<Functor()>;
+
+    /* 绑定一个loop的有序提交通道，只能在该loop线程中使用 */
+    class Sequencer : noncopyable
+    {
+    public:
+        explicit Sequencer(EventLoop *loop)
+            : loop_(loop),
+              nextSubmit_(0),
+              nextDeliver_(0)
+        {
+        }
+
+        EventLoop *getLoop() const { return loop_; }
+        /* 已提交但结果还没有回到loop的任务数 */
+        size_t inFlight() const { return static_cast<size_t>(nextSubmit_ - nextDeliver_); }
+
+    private:
+        friend class ComputePool;
+
+        /* 在loop线程中收到第id个任务的结果，先到的结果暂存，按序号依次执行 */
+        void complete(uint64_t id, const Functor &done);
+
+        EventLoop *loop_;
+        uint64_t nextSubmit_;
+        uint64_t nextDeliver_;
+        std::map<uint64_t, Functor> ready_;
+    };
+    using SequencerPtr = std::shared_ptr<Sequencer>;
+
+    struct WorkerStats
+    {
+        int64_t executed; // 执行过的任务数(含窃取的)
+        int64_t stolen;   // 从其他线程队列中窃取的任务数
+        int64_t busyUs;   // 执行任务累计花费的微秒数
+        size_t queued;    // 当前队列中等待的任务数
+    };
+
+    static const size_t kDefaultMaxQueueSize = 1024;
+
+    ComputePool(int numThreads, size_t maxQueueSize = kDefaultMaxQueueSize);
+    ~ComputePool();
+
+    void start();
+    void stop(); // 执行完已提交的任务后退出所有计算线程
+
+    /* 结果投递回loop，不保证顺序；任何线程都可以调用，队列已满或线程池未运行时返回false */
+    bool submit(EventLoop *loop, const Work &work);
+    /* 结果按提交顺序投递回sequencer的loop，只能在该loop线程中调用，队列已满或线程池未运行时返回false */
+    bool submit(const SequencerPtr &sequencer, const Work &work);
+
+    size_t pending() const { return static_cast<size_t>(pending_.load(std::memory_order_relaxed)); }
+    int64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    std::vector<WorkerStats> stats() const;
+
+private:
+    struct Task
+    {
+        Work work;
+        EventLoop *loop;
+        SequencerPtr sequencer; // 无序提交时为空
+        uint64_t id;
+    };
+    struct Worker;
+
+    /* 放入一个未满的队列，从调用者所在的计算线程或轮询的下一个线程开始找 */
+    bool push(Task &&task);
+    bool popLocal(int index, Task *task);
+    bool steal(int index, Task *task);
+    void run(int index, Task &task);
+    void workerFunc(int index);
+
+    const int numThreads_;
+    const size_t maxQueueSize_; // 每个计算线程的队列上限
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned> next_;
+    std::atomic<int64_t> pending_; // 所有队列中的任务总数
+    std::atomic<int64_t> rejected_;
+
+    /* 没有任务时计算线程在cond_上等待，sleepers_不为0时提交者才需要加锁通知 */
+    std::mutex sleepMutex_;
+    std::condition_variable cond_;
+    std::atomic<int> sleepers_;
+};
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 
 #include "Connector.h"
 #include "Logger.h"
@@ -21,6 +22,12 @@ Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
 Connector::~Connector()
 {
     loop_->cancel(timerId_);
+    /* 析构时仍在连接中，注销Channel并关闭套接字，否则Poller中会留下悬空的Channel，只能在loop线程中析构 */
+    if (state_ == kConnecting)
+    {
+        loop_->assertInLoopThread();
+        Socket::close(removeAndResetChannel());
+    }
 }
 
 void Connector::start()
@@ -61,11 +68,11 @@ void Connector::stop()
 
 void Connector::connect()
 {
-    int sockfd = Socket::createNonblocking();
+    int sockfd = Socket::createNonblocking(serverAddr_.family());
     const struct sockaddr *addr = serverAddr_.getSockaddr();
     int ret = ::connect(sockfd,
                         addr,
-                        static_cast<socklen_t>(sizeof(struct sockaddr_in)));
+                        serverAddr_.getSockaddrLen());
     int savedErrno = (ret == 0) ? 0 : errno;
     switch (savedErrno)
     {
@@ -81,6 +88,7 @@ void Connector::connect()
     case EADDRNOTAVAIL: // 请求地址不可用，可能是网络连接超时，可以尝试再次连接
     case ECONNREFUSED:  // 服务器当时拒绝连接，可能稍后开始接受连接，可以尝试再次连接
     case ENETUNREACH:   // 网络当时时刻不可达，可以尝试重新连接
+    case ENOENT:        // Unix域套接字文件尚未创建，服务器可能还没启动
         retry(sockfd);
         break;
 
@@ -112,17 +120,14 @@ void Connector::connecting(int sockfd)
     channel_->enableWriting();
 }
 
-void Connector::resetChannel()
-{
-    channel_.reset();
-}
-
 int Connector::removeAndResetChannel()
 {
     int sockfd = channel_->fd();
     channel_->disableAll();
     loop_->removeChannel(channel_.get());
-    loop_->queueInLoop(std::bind(&Connector::resetChannel, this));
+    /* 可能正处于Channel的事件回调中，延后析构；Channel交给回调持有，Connector先析构也不会悬空 */
+    std::shared_ptr<Channel> channel(channel_.release());
+    loop_->queueInLoop([channel]() {});
     return sockfd;
 }
 
@@ -135,7 +140,9 @@ void Connector::retry(int sockfd)
         LOG_INFO("Connector::retry - Retrying connecting to %s in %d millseconds",
                  serverAddr_.toIpPort().c_str(),
                  retryDelayMs_);
-        timerId_ = loop_->runAfter(retryDelayMs_ / 1000.0, std::bind(&Connector::connect, this));
+        /* 重连不要求准时，允许推迟10%，与其他定时器合并唤醒 */
+        timerId_ = loop_->runAfter(retryDelayMs_ / 1000.0, std::bind(&Connector::connect, this),
+                                   retryDelayMs_ / 10000.0);
         retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
     }
 }
@@ -151,7 +158,8 @@ void Connector::handleWrite()
         /* 处理其他可能存在的错误*/
         if (err)
         {
-            LOG_DEBUG("Connector::handleWrite - SO_ERROR %d: %s", err, strerror_l(err));
+            LOG_DEBUG("Connector::handleWrite - SO_ERROR %d: %s", err, strerror(err));
+            retry(sockfd);
         }
         /* 即使能连接，也有可能是自连接（连接到本地主机IP地址和侦听端口上）*/
         else if (Socket::isSelfConnection(sockfd))
@@ -190,7 +198,7 @@ void Connector::handleError()
         int sockfd = removeAndResetChannel();
         int err = Socket::getSocketError(sockfd);
 
-        LOG_DEBUG("SO_ERROR %d: %s", err, strerror_l(err));
+        LOG_DEBUG("SO_ERROR %d: %s", err, strerror(err));
         retry(sockfd);
     }
 }
\ No newline at end of file
@@ -53,7 +53,6 @@ private:
     void connect();     // 封装::conect()，以便具备反复连接和处理各种错误的功能
     void connecting(int sockfd);
     void retry(int sockfd); // 关闭套接字，并定期反复尝试连接
-    void resetChannel();
     int removeAndResetChannel();
 
     EventLoop *loop_;
@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "TimerBackend.h"
+#include "TimerSet.h"
+#include "TimerHeap.h"
+#include "TimingWheel.h"
+
+TimerBackend *TimerBackend::newBackend(Type type)
+{
+    switch (type)
+    {
+    case kHeap:
+        return new TimerHeap;
+    case kWheel:
+        return new TimingWheel;
+    case kSet:
+    default:
+        return new TimerSet;
+    }
+}
+
+TimerBackend *TimerBackend::newDefaultBackend()
+{
+    const char *backend = ::getenv("TIMER_BACKEND");
+    if (backend && ::strcmp(backend, "wheel") == 0)
+    {
+        return newBackend(kWheel);
+    }
+    else if (backend && ::strcmp(backend, "heap") == 0)
+    {
+        return newBackend(kHeap);
+    }
+    else
+    {
+        return newBackend(kSet);
+    }
+}
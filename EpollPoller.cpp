@@ -30,7 +30,7 @@ EpollPoller::~EpollPoller()
 
 Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    LOG_DEBUG("fd total count %u", channels_.count);
+    LOG_DEBUG("fd table size %zu", channels_.size());
     int numEvents = ::epoll_wait(epollfd_,
                                  events_.data(),
                                  static_cast<int>(events_.size()),
@@ -74,15 +74,14 @@ void EpollPoller::updateChannel(Channel *channel)
         /* 没有在监听列表中则加入到监听列表中 */
         if (index == kNew)
         {
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;
+            assert(findChannel(fd) == nullptr);
+            addChannel(channel);
         }
 
         /* 在监听列表中但处于无监听状态 */
         if (index == kDeleted)
         {
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
+            assert(findChannel(fd) == channel);
         }
 
         /* 标记为监听，将需要监听描述符加入epoll对象当中 */
@@ -92,8 +91,7 @@ void EpollPoller::updateChannel(Channel *channel)
     else    //对处于监听状态的描述符做处理
     {
         (void)fd;
-        assert(channels_.find(fd) != channels_.end());
-        assert(channels_[fd] == channel);
+        assert(findChannel(fd) == channel);
 
         /* 如果Channel设置为无监听状态，则移除epoll对象对该描述符的监听事件 */
         if (channel->isNoneEvents())
@@ -113,8 +111,7 @@ void EpollPoller::removeChannel(Channel *channel)
 {
     Poller::assertInLoopThread();
     int fd = channel->fd();
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(findChannel(fd) == channel);
     assert(channel->isNoneEvents());
     const int index = channel->index();
     assert(index == kAdded || index == kDeleted);
@@ -125,9 +122,7 @@ void EpollPoller::removeChannel(Channel *channel)
         update(EPOLL_CTL_DEL, channel);
     }
 
-    size_t n = channels_.erase(fd);
-    assert(n == 1);
-    (void)n;
+    eraseChannel(fd);
     channel->set_index(kNew);
 }
 
@@ -138,10 +133,7 @@ void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
     {
         Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
 #ifndef NDEBUG //非发布版本执行以下断言
-        int fd = channel->fd();
-        ChannelMap::const_iterator it = channels_.find(fd);
-        assert(it != channels_.end());
-        assert(it->second == channel);
+        assert(findChannel(channel->fd()) == channel);
 #endif
         channel->set_revents(events_[i].events);
         activeChannels->push_back(channel);
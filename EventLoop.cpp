@@ -1,5 +1,6 @@
 #include <vector>
 #include <functional>
+#include <algorithm>
 #include <mutex>
 #include <signal.h>
 #include <assert.h>
@@ -46,7 +47,12 @@ EventLoop::EventLoop()
       poller_(Poller::newDefaultPoller(this)),
       timerQueue_(new TimerQueue(this)),
       wakeupFd_(createEventFd()),
-      wakeupChannel_(new Channel(this, wakeupFd_))
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      numConnections_(0),
+      busyTimeUs_(0),
+      loopTime_(Timestamp::monotonicNow()),
+      iterationStartUs_(0),
+      lastIterationUs_(0)
 {
     LOG_DEBUG("EventLoop created %p in this thread%d.\n", this, threadId_);
     if (t_loopInthisThread)
@@ -78,18 +84,37 @@ void EventLoop::loop()
     while (!quit_)
     {
         activeChannels_.clear();
+        flushChannelUpdates();
         Timestamp receiveTime = poller_->poll(kPollTimeMs, &activeChannels_);
+        loopTime_ = Timestamp::monotonicNow();
+        iterationStartUs_.store(loopTime_.microSecondsSinceEpoch(), std::memory_order_relaxed);
         for (ChannelList::iterator it = activeChannels_.begin(); it != activeChannels_.end(); it++)
         {
             (*it)->handleEvent(receiveTime);
         }
         doPendingFunctors();
+        /* 只有本线程写，relaxed即可 */
+        int64_t busy = Timestamp::monotonicNow().microSecondsSinceEpoch() - loopTime_.microSecondsSinceEpoch();
+        busyTimeUs_.store(busyTimeUs_.load(std::memory_order_relaxed) + busy, std::memory_order_relaxed);
+        lastIterationUs_.store(busy, std::memory_order_relaxed);
+        iterationStartUs_.store(0, std::memory_order_relaxed);
     }
 
     LOG_DEBUG("EventLoop %p stop looping.\n", this);
     looping_ = false;
 }
 
+int64_t EventLoop::iterationLagUs() const
+{
+    int64_t start = iterationStartUs_.load(std::memory_order_relaxed);
+    if (start == 0)
+    {
+        return 0;
+    }
+    int64_t running = Timestamp::monotonicNow().microSecondsSinceEpoch() - start;
+    return std::max(running, lastIterationUs_.load(std::memory_order_relaxed));
+}
+
 void EventLoop::quit()
 {
     quit_ = true;
@@ -127,32 +152,56 @@ void EventLoop::updateChannel(Channel *channel)
 {
     assertInLoopThread();
     assert(channel->ownerLoop() == this);
-    poller_->updateChannel(channel);
+    if (!channel->pendingUpdate())
+    {
+        channel->set_pendingUpdate(true);
+        dirtyChannels_.push_back(channel);
+    }
 }
 
 void EventLoop::removeChannel(Channel *channel)
 {
     assertInLoopThread();
     assert(channel->ownerLoop() == this);
-    poller_->removeChannel(channel);
+    /* Channel移除后可能马上析构，不能继续留在脏列表中 */
+    if (channel->pendingUpdate())
+    {
+        dirtyChannels_.erase(std::find(dirtyChannels_.begin(), dirtyChannels_.end(), channel));
+        applyChannelUpdate(channel);
+    }
+    /* 从未提交给Poller的Channel(index为-1)无需移除 */
+    if (channel->index() >= 0)
+    {
+        poller_->removeChannel(channel);
+    }
+    channel->set_polledEvents(0);
+}
+
+/* 其他线程读不到loopTime_，只能现取 */
+Timestamp EventLoop::timerBase() const
+{
+    return isInLoopThread() ? loopTime_ : Timestamp::monotonicNow();
 }
 
-TimerId EventLoop::runAt(const Timestamp &time, const TimerCallback &cb)
+TimerId EventLoop::runAt(const Timestamp &time, const TimerCallback &cb, double slack)
 {
     assert(timerQueue_ != NULL);
-    return timerQueue_->addTimer(time, cb, 0.0);
+    /* 墙上时间换算成单调时钟，只在加入时取一次两者的差 */
+    int64_t delta = time.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    Timestamp when(Timestamp::monotonicNow().microSecondsSinceEpoch() + delta);
+    return timerQueue_->addTimer(when, cb, 0.0, slack);
 }
 
-TimerId EventLoop::runAfter(double delay, const TimerCallback &cb)
+TimerId EventLoop::runAfter(double delay, const TimerCallback &cb, double slack)
 {
-    Timestamp time(addTime(Timestamp::now(), delay));
-    return runAt(time, cb);
+    Timestamp when(addTime(timerBase(), delay));
+    return timerQueue_->addTimer(when, cb, 0.0, slack);
 }
 
-TimerId EventLoop::runEvery(double interval, const TimerCallback &cb)
+TimerId EventLoop::runEvery(double interval, const TimerCallback &cb, double slack)
 {
-    Timestamp time(addTime(Timestamp::now(), interval));
-    return timerQueue_->addTimer(time, cb, interval);
+    Timestamp when(addTime(timerBase(), interval));
+    return timerQueue_->addTimer(when, cb, interval, slack);
 }
 
 void EventLoop::cancel(TimerId timerId)
@@ -160,6 +209,11 @@ void EventLoop::cancel(TimerId timerId)
     timerQueue_->cancel(timerId);
 }
 
+void EventLoop::setTimerBackend(TimerBackend::Type type)
+{
+    runInLoop(std::bind(&TimerQueue::setBackend, timerQueue_.get(), type));
+}
+
 void EventLoop::wakeup()
 {
     uint64_t one = 1;
@@ -190,6 +244,26 @@ void EventLoop::handleRead()
     }
 }
 
+void EventLoop::flushChannelUpdates()
+{
+    for (Channel *channel : dirtyChannels_)
+    {
+        applyChannelUpdate(channel);
+    }
+    dirtyChannels_.clear();
+}
+
+void EventLoop::applyChannelUpdate(Channel *channel)
+{
+    channel->set_pendingUpdate(false);
+    /* 例如先enableWriting()再disableWriting()，净变化为零，就省去两次epoll_ctl */
+    if (channel->events() != channel->polledEvents())
+    {
+        poller_->updateChannel(channel);
+        channel->set_polledEvents(channel->events());
+    }
+}
+
 void EventLoop::doPendingFunctors()
 {
     std::vector<Functor> functors;
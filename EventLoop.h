@@ -4,6 +4,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <atomic>
 
 #include "CurrentThread.h"
 #include "Callbacks.h"
@@ -43,25 +44,37 @@ public:
     void queueInLoop(const Functor &cb);
 
     /**
-     * 调用Poller更新维护或移除Channel，而不再过多关注
+     * -updateChannel()只把Channel登记到脏列表，同一轮循环内的多次修改会被合并，
+     *  在下一次poll前只把净变化交给Poller(即只发起必要的epoll_ctl)；
+     * -removeChannel()会先落实该Channel尚未提交的修改，再调用Poller移除。
      */
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
 
     /**
-     * -可以通过调用定时器来执行回调函数；
-     * -runAt()指定特定时间戳执行回调；
-     * -runAfter()指定延时的时间段之后(从当前运行时计时)执行回调；
-     * -runEvery()指定定期间隔循环执行回调。
+     * -可以通过调用定时器来执行回调函数，定时器内部统一使用单调时钟；
+     * -runAt()指定特定时间戳(墙上时间)执行回调，加入时换算成单调时钟，之后调时不影响它；
+     * -runAfter()指定延时的时间段之后执行回调，在loop线程中从本轮的now()起算；
+     * -runEvery()指定定期间隔循环执行回调；
+     * -slack是允许推迟的秒数，不要求精确的定时器(心跳、重连、空闲检查)给一个容差，
+     *  容差窗口重叠的定时器会合并到同一次唤醒，减少timerfd_settime和唤醒的次数。
      */
-    TimerId runAt(const Timestamp &time, const TimerCallback &cb);
-    TimerId runAfter(double delay, const TimerCallback &cb);
-    TimerId runEvery(double interval, const TimerCallback &cb);
+    TimerId runAt(const Timestamp &time, const TimerCallback &cb, double slack = 0.0);
+    TimerId runAfter(double delay, const TimerCallback &cb, double slack = 0.0);
+    TimerId runEvery(double interval, const TimerCallback &cb, double slack = 0.0);
     void cancel(TimerId timerId);
+    /* 为本loop指定定时器后端(见TimerBackend)，已有的定时器会迁移过去，任何线程都可以调用 */
+    void setTimerBackend(TimerBackend::Type type);
+
+    /**
+     * 本轮循环的时间(单调时钟)，每次poll返回后更新一次，读取不需要系统调用；
+     * 只能在loop线程中使用，回调耗时较长时会比实际时间略早
+     */
+    Timestamp now() const { return loopTime_; }
 
     void wakeup(); // 任何其他线程都能唤醒该EventLoop
 
-    EventLoop *getEventLoopOfCurrentThread(); // 返回当前执行线程原先绑定的EventLoop对象
+    static EventLoop *getEventLoopOfCurrentThread(); // 返回当前执行线程原先绑定的EventLoop对象，没有时返回nullptr
     void assertInLoopThread()
     {
         if (!isInLoopThread())
@@ -71,10 +84,28 @@ public:
     }
     bool isInLoopThread() const { return CurrentThread::tid() == threadId_; } // 确认当前执行线程是本线程
 
+    /**
+     * 负载信号，供baseLoop选择IO线程时无锁读取：
+     * -connectionCount()是该loop上尚未销毁的TcpConnection数量；
+     * -busyTimeUs()是该loop处理活跃事件和回调累计花费的微秒数，两次采样之差除以间隔即为利用率。
+     */
+    int connectionCount() const { return numConnections_.load(std::memory_order_relaxed); }
+    int64_t busyTimeUs() const { return busyTimeUs_.load(std::memory_order_relaxed); }
+    void incConnections() { numConnections_.fetch_add(1, std::memory_order_relaxed); }
+    void decConnections() { numConnections_.fetch_sub(1, std::memory_order_relaxed); }
+    /**
+     * 循环延迟：阻塞在poll上时为0(说明可以立即处理新任务)，
+     * 否则取当前这一轮已经执行的时间和上一轮完整循环耗时的较大者，任意线程都可以调用
+     */
+    int64_t iterationLagUs() const;
+
 private:
     void abortNotInThread();
+    Timestamp timerBase() const; // runAfter()/runEvery()的起算时间
     void handleRead(); // 被唤醒时触发该读事件
     void doPendingFunctors();
+    void flushChannelUpdates();             // poll前统一提交脏列表中的监听修改
+    void applyChannelUpdate(Channel *channel); // 仅当监听事件确实改变时才通知Poller
     using ChannelList = std::vector<Channel *>;
 
     bool looping_;
@@ -83,9 +114,15 @@ private:
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannel_; // 一个EventLoop只能持有一个wakeupChannel
     ChannelList activeChannels_;
+    ChannelList dirtyChannels_; // 本轮循环内修改过监听事件的Channel
     std::unique_ptr<Poller> poller_; // 一个EventLoop只能持有一个poller
     bool callingPendingFucntors_;
     std::unique_ptr<TimerQueue> timerQueue_; // 一个EventLoop只能持有一个timerQueue
     std::mutex mutex_;
     std::vector<Functor> pendingFunctors_; // pendingFunctors_是多生产者单消费者问题
+    std::atomic<int> numConnections_;
+    std::atomic<int64_t> busyTimeUs_;
+    Timestamp loopTime_;                    // 本轮poll返回的时刻(单调时钟)
+    std::atomic<int64_t> iterationStartUs_; // 本轮poll返回的时刻(单调时钟)，阻塞在poll上时为0
+    std::atomic<int64_t> lastIterationUs_;  // 上一轮处理事件和回调的耗时
 };
\ No newline at end of file
@@ -1,17 +1,39 @@
 #include <assert.h>
+#include <algorithm>
 
 #include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "Logger.h"
+
+/* 32位整数的混淆函数(murmur3 finalizer)，让相邻的IP和虚拟节点编号在环上均匀分布 */
+static uint32_t mixHash(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop)
     : baseLoop_(baseLoop),
       started_(false),
       numThreads_(0),
-      next_(0)
+      next_(0),
+      nextLoopId_(0),
+      strategy_(kRoundRobin),
+      lastSampleTimeUs_(0),
+      retireTimerArmed_(false)
 {
 }
 
 EventLoopThreadPool::~EventLoopThreadPool()
 {
+    if (retireTimerArmed_)
+    {
+        baseLoop_->cancel(retireTimer_);
+    }
 }
 
 void EventLoopThreadPool::start()
@@ -27,7 +49,11 @@ void EventLoopThreadPool::start()
         /* 由线程池独占管理线程对象的生命期 */
         threads_.push_back(
             std::move(std::unique_ptr<EventLoopThread>(thread)));
+        loopIds_.push_back(nextLoopId_++);
     }
+    lastBusyTimeUs_.assign(loops_.size(), 0);
+    recentBusyTimeUs_.assign(loops_.size(), 0);
+    buildHashRing();
 }
 
 EventLoop *EventLoopThreadPool::getNextLoop()
@@ -44,4 +70,204 @@ EventLoop *EventLoopThreadPool::getNextLoop()
             next_ = 0;
     }
     return loop;
-}
\ No newline at end of file
+}
+
+EventLoop *EventLoopThreadPool::getNextLoop(const InetAddress &peerAddr)
+{
+    baseLoop_->assertInLoopThread();
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+    if (selector_)
+    {
+        return selector_(loops_, peerAddr);
+    }
+
+    switch (strategy_)
+    {
+    case kLeastConnections:
+        return getLeastConnections();
+    case kLeastBusy:
+        return getLeastBusy();
+    case kConsistentHash:
+        return getByConsistentHash(peerAddr);
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
+std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
+{
+    assert(started_);
+    if (loops_.empty())
+    {
+        return std::vector<EventLoop *>(1, baseLoop_);
+    }
+    return loops_;
+}
+
+EventLoop *EventLoopThreadPool::addLoop()
+{
+    assert(started_);
+    baseLoop_->assertInLoopThread();
+
+    std::unique_ptr<EventLoopThread> thread(new EventLoopThread());
+    EventLoop *loop = thread->startLoop();
+    loops_.push_back(loop);
+    threads_.push_back(std::move(thread));
+    loopIds_.push_back(nextLoopId_++);
+    /* 新loop的忙碌时间从0开始，下一个采样区间之前被视为最空闲 */
+    lastBusyTimeUs_.push_back(loop->busyTimeUs());
+    recentBusyTimeUs_.push_back(0);
+    buildHashRing();
+    LOG_INFO("EventLoopThreadPool::addLoop %p, %zu loops", loop, loops_.size());
+    return loop;
+}
+
+bool EventLoopThreadPool::retireLoop(EventLoop *loop, const RetiredCallback &cb, const IdleCheck &idle)
+{
+    assert(started_);
+    baseLoop_->assertInLoopThread();
+
+    auto it = std::find(loops_.begin(), loops_.end(), loop);
+    if (it == loops_.end() || loops_.size() == 1)
+    {
+        LOG_ERROR("EventLoopThreadPool::retireLoop %p refused, %zu loops", loop, loops_.size());
+        return false;
+    }
+    size_t idx = it - loops_.begin();
+    retiring_.push_back(RetiringLoop{loop, std::move(threads_[idx]), cb, idle});
+    loops_.erase(it);
+    threads_.erase(threads_.begin() + idx);
+    loopIds_.erase(loopIds_.begin() + idx);
+    lastBusyTimeUs_.erase(lastBusyTimeUs_.begin() + idx);
+    recentBusyTimeUs_.erase(recentBusyTimeUs_.begin() + idx);
+    if (static_cast<size_t>(next_) >= loops_.size())
+    {
+        next_ = 0;
+    }
+    buildHashRing();
+    LOG_INFO("EventLoopThreadPool::retireLoop %p with %d connections, %zu loops left",
+             loop, loop->connectionCount(), loops_.size());
+
+    if (!retireTimerArmed_)
+    {
+        retireTimerArmed_ = true;
+        retireTimer_ = baseLoop_->runEvery(kRetireCheckIntervalMs / 1000.0,
+                                           std::bind(&EventLoopThreadPool::checkRetiring, this));
+    }
+    return true;
+}
+
+EventLoop *EventLoopThreadPool::getLeastConnections()
+{
+    /* 从轮询位置开始比较，连接数相同时不会总是偏向第一个loop */
+    size_t n = loops_.size();
+    size_t best = next_;
+    for (size_t i = 1; i < n; i++)
+    {
+        size_t idx = (next_ + i) % n;
+        if (loops_[idx]->connectionCount() < loops_[best]->connectionCount())
+        {
+            best = idx;
+        }
+    }
+    next_ = static_cast<int>((next_ + 1) % n);
+    return loops_[best];
+}
+
+EventLoop *EventLoopThreadPool::getLeastBusy()
+{
+    sampleBusyTime();
+    /**
+     * 采样区间内各loop的忙碌时间不变，若总是选最小者，区间内的所有新连接都会涌向同一个loop；
+     * 所以采用"两者择优"：轮询取出两个候选，选择其中较空闲的一个，负载越高的loop被选中的概率越低
+     */
+    size_t n = loops_.size();
+    size_t a = next_;
+    size_t b = (next_ + 1) % n;
+    next_ = static_cast<int>((next_ + 1) % n);
+    return recentBusyTimeUs_[b] < recentBusyTimeUs_[a] ? loops_[b] : loops_[a];
+}
+
+EventLoop *EventLoopThreadPool::getByConsistentHash(const InetAddress &peerAddr)
+{
+    /* Unix域的对端通常没有地址，散列没有意义，退化为轮询 */
+    if (peerAddr.family() != AF_INET)
+    {
+        return getNextLoop();
+    }
+    uint32_t h = mixHash(reinterpret_cast<const sockaddr_in *>(peerAddr.getSockaddr())->sin_addr.s_addr);
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(h, static_cast<EventLoop *>(nullptr)));
+    if (it == ring_.end())
+    {
+        it = ring_.begin(); // 环形回绕
+    }
+    return it->second;
+}
+
+void EventLoopThreadPool::sampleBusyTime()
+{
+    int64_t now = Timestamp::monotonicNow().microSecondsSinceEpoch();
+    if (now - lastSampleTimeUs_ < kBusySampleIntervalUs)
+    {
+        return;
+    }
+    lastSampleTimeUs_ = now;
+    for (size_t i = 0; i < loops_.size(); i++)
+    {
+        int64_t busy = loops_[i]->busyTimeUs();
+        recentBusyTimeUs_[i] = busy - lastBusyTimeUs_[i];
+        lastBusyTimeUs_[i] = busy;
+    }
+}
+
+void EventLoopThreadPool::buildHashRing()
+{
+    ring_.clear();
+    for (size_t i = 0; i < loops_.size(); i++)
+    {
+        for (uint32_t v = 0; v < kVirtualNodesPerLoop; v++)
+        {
+            ring_.emplace_back(mixHash(loopIds_[i] * 0x9e3779b9 + v), loops_[i]);
+        }
+    }
+    std::sort(ring_.begin(), ring_.end());
+}
+
+void EventLoopThreadPool::checkRetiring()
+{
+    /* 先把要结束的取出来，回调中可能再次调用retireLoop() */
+    std::vector<RetiringLoop> retired;
+    for (auto it = retiring_.begin(); it != retiring_.end();)
+    {
+        /* 连接数在TcpConnection构造时就已计入，不再分配新连接后它只会减少 */
+        bool idle = it->idle ? it->idle(it->loop) : it->loop->connectionCount() == 0;
+        if (idle)
+        {
+            retired.push_back(std::move(*it));
+            it = retiring_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (retiring_.empty())
+    {
+        baseLoop_->cancel(retireTimer_);
+        retireTimerArmed_ = false;
+    }
+
+    for (RetiringLoop &r : retired)
+    {
+        if (r.cb)
+        {
+            r.cb(r.loop);
+        }
+        LOG_INFO("EventLoopThreadPool::checkRetiring loop %p exited", r.loop);
+        r.thread.reset(); // 退出loop并等待线程结束
+    }
+}
@@ -1,27 +1,102 @@
+#pragma once
+
 #include <vector>
 #include <memory>
+#include <functional>
+#include <stdint.h>
 
 #include "EventLoop.h"
 #include "EventLoopThread.h"
+#include "TimerId.h"
 #include "noncopyable.h"
 
+class InetAddress;
+
 /* 线程池 - 每个线程绑定EventLoop供每个TcpConnection循环利用，负责创建线程与循环并提供 */
 class EventLoopThreadPool : noncopyable
 {
 public:
+    /* 为新连接选择IO线程的内置策略 */
+    enum Strategy
+    {
+        kRoundRobin,       // 轮询，每个loop的优先级都是平等的
+        kLeastConnections, // 选择连接数最少的loop
+        kLeastBusy,        // 选择最近一段时间利用率(忙碌时间占比)较低的loop
+        kConsistentHash,   // 按对端IP做一致性哈希，同一客户端总是落在同一个loop上，利于缓存亲和
+    };
+    /* 自定义策略，loops非空，返回值必须是loops中的一个 */
+    using LoopSelector = std::function<EventLoop *(const std::vector<EventLoop *> &loops,
+                                                   const InetAddress &peerAddr)>;
+
     EventLoopThreadPool(EventLoop *baseLoop);
     ~EventLoopThreadPool();
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    void setStrategy(Strategy strategy) { strategy_ = strategy; }
+    void setLoopSelector(const LoopSelector &selector) { selector_ = std::move(selector); } // 设置后优先于内置策略
     void start();
     EventLoop *getNextLoop();
+    /* 按所设置的策略为来自peerAddr的新连接选择loop */
+    EventLoop *getNextLoop(const InetAddress &peerAddr);
+    /* 返回所有IO线程的loop，没有IO线程时只返回baseLoop_ */
+    std::vector<EventLoop *> getAllLoops();
+
+    /**
+     * 运行时扩缩容，只能在baseLoop线程中、start()之后调用：
+     * -addLoop()启动一个新的IO线程并立即参与分配，返回其loop；
+     * -retireLoop()把loop移出分配范围，getNextLoop()和各个策略都不再选中它，
+     *  在baseLoop中定时调用idle，返回true后执行cb，随后退出该IO线程；
+     *  idle为空时等待loop上的TcpConnection全部销毁；
+     *  至少要保留一个IO线程，loop不在池中或是最后一个时返回false。
+     * 退休只等待idle所判断的任务，loop上的其他任务(定时器、TcpClient等)需要调用者在cb之前自行迁走
+     */
+    using RetiredCallback = std::function<void(EventLoop *loop)>;
+    using IdleCheck = std::function<bool(EventLoop *loop)>;
+    EventLoop *addLoop();
+    bool retireLoop(EventLoop *loop, const RetiredCallback &cb = RetiredCallback(),
+                    const IdleCheck &idle = IdleCheck());
+    size_t numLoops() const { return loops_.size(); }
+    size_t numRetiring() const { return retiring_.size(); }
 
 private:
     using EventLoopThreadPtrs = std::vector<std::unique_ptr<EventLoopThread>>;
+    using HashRing = std::vector<std::pair<uint32_t, EventLoop *>>; // 按哈希值排序的虚拟节点
+
+    /* 正在退休的IO线程，idle返回true后才析构线程对象 */
+    struct RetiringLoop
+    {
+        EventLoop *loop;
+        std::unique_ptr<EventLoopThread> thread;
+        RetiredCallback cb;
+        IdleCheck idle;
+    };
+
+    static const int kVirtualNodesPerLoop = 64;
+    static const int64_t kBusySampleIntervalUs = 100 * 1000;
+    static const int kRetireCheckIntervalMs = 100;
+
+    EventLoop *getLeastConnections();
+    EventLoop *getLeastBusy();
+    EventLoop *getByConsistentHash(const InetAddress &peerAddr);
+    void sampleBusyTime(); // 每隔kBusySampleIntervalUs计算各loop在上个采样区间内的忙碌时间
+    void buildHashRing();
+    void checkRetiring(); // 定时检查退休的loop，结束已经空闲的IO线程
 
     EventLoop *baseLoop_;
     bool started_;
     int numThreads_;
     int next_;
     std::vector<EventLoop *> loops_;
-    EventLoopThreadPtrs threads_;
-};
\ No newline at end of file
+    EventLoopThreadPtrs threads_; // 与loops_一一对应
+    /* 各loop在哈希环上的编号，增删loop时其他loop的虚拟节点不变，只有约1/n的客户端改变归属 */
+    std::vector<uint32_t> loopIds_;
+    uint32_t nextLoopId_;
+    Strategy strategy_;
+    LoopSelector selector_;
+    int64_t lastSampleTimeUs_;
+    std::vector<int64_t> lastBusyTimeUs_;   // 上次采样时各loop的累计忙碌时间
+    std::vector<int64_t> recentBusyTimeUs_; // 各loop在最近一个采样区间内的忙碌时间
+    HashRing ring_;
+    std::vector<RetiringLoop> retiring_;
+    TimerId retireTimer_;
+    bool retireTimerArmed_;
+};
@@ -1,36 +1,113 @@
 #include <netinet/ip.h>
 #include <string>
 #include <arpa/inet.h>
+#include <stddef.h>
 
 #include "Logger.h"
 #include "InetAddress.h"
 
+InetAddress::InetAddress(const sockaddr_in &addr)
+{
+    setSockaddr(reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+}
+
 InetAddress::InetAddress(const uint16_t &port)
 {
     memset(&addr_, 0, sizeof(addr_));
-    addr_.sin_family = AF_INET;
-    addr_.sin_addr.s_addr = ::htonl(INADDR_ANY);
-    addr_.sin_port = ::htons(port);
+    struct sockaddr_in *addr4 = reinterpret_cast<sockaddr_in *>(&addr_);
+    addr4->sin_family = AF_INET;
+    addr4->sin_addr.s_addr = ::htonl(INADDR_ANY);
+    addr4->sin_port = ::htons(port);
+    len_ = sizeof(sockaddr_in);
+}
+
+InetAddress::InetAddress(const struct sockaddr *addr, socklen_t len)
+{
+    setSockaddr(addr, len);
+}
+
+InetAddress InetAddress::fromUnixPath(const std::string &path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    {
+        LOG_FATAL("InetAddress::fromUnixPath invalid path: %s", path.c_str());
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    if (path[0] == '@')
+    {
+        addr.sun_path[0] = '\0'; // 抽象命名空间，长度中不包含结尾的'\0'
+    }
+    socklen_t len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path.size() + (path[0] == '@' ? 0 : 1));
+    return InetAddress(reinterpret_cast<const sockaddr *>(&addr), len);
+}
+
+void InetAddress::setSockaddr(const struct sockaddr *addr, socklen_t len)
+{
+    memset(&addr_, 0, sizeof(addr_));
+    len_ = len < sizeof(addr_) ? len : sizeof(addr_);
+    memcpy(&addr_, addr, len_);
+}
+
+std::string InetAddress::toUnixPath() const
+{
+    if (!isUnix())
+    {
+        return std::string();
+    }
+    const struct sockaddr_un *addr = reinterpret_cast<const sockaddr_un *>(&addr_);
+    size_t offset = offsetof(struct sockaddr_un, sun_path);
+    if (len_ <= offset)
+    {
+        return std::string(); // 未命名的套接字，例如客户端一侧
+    }
+    size_t n = len_ - offset;
+    if (addr->sun_path[0] == '\0')
+    {
+        return "@" + std::string(addr->sun_path + 1, n - 1);
+    }
+    return std::string(addr->sun_path, ::strnlen(addr->sun_path, n));
 }
 
 std::string InetAddress::toIp() const
 {
-    char buf[64];
-    ::inet_ntop(AF_INET, &addr_.sin_addr.s_addr, buf, sizeof(addr_));
+    char buf[64] = "";
+    switch (addr_.ss_family)
+    {
+    case AF_INET:
+        ::inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in *>(&addr_)->sin_addr, buf, sizeof(buf));
+        break;
+    case AF_INET6:
+        ::inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6 *>(&addr_)->sin6_addr, buf, sizeof(buf));
+        break;
+    case AF_UNIX:
+        return toUnixPath();
+    }
     return buf;
 }
 
 std::string InetAddress::toIpPort() const
 {
+    if (isUnix())
+    {
+        return "unix:" + toUnixPath();
+    }
     char buf[64];
-    ::inet_ntop(AF_INET, &addr_.sin_addr.s_addr, buf, sizeof(addr_));
-    ssize_t end = ::strlen(buf);
-    uint16_t port = ::ntohs(addr_.sin_port);
-    sprintf(buf + end, ":%u", port);
+    snprintf(buf, sizeof(buf), "%s:%u", toIp().c_str(), toPort());
     return buf;
 }
 
 uint16_t InetAddress::toPort() const
 {
-    return ::ntohs(addr_.sin_port);
-}
\ No newline at end of file
+    switch (addr_.ss_family)
+    {
+    case AF_INET:
+        return ::ntohs(reinterpret_cast<const sockaddr_in *>(&addr_)->sin_port);
+    case AF_INET6:
+        return ::ntohs(reinterpret_cast<const sockaddr_in6 *>(&addr_)->sin6_port);
+    default:
+        return 0;
+    }
+}
@@ -1,27 +1,35 @@
 #pragma once
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <string>
 #include <cstring>
 
 /**
- * -对sockaddr_in简单封装
- * -将网络字节流转化为字符串
+ * -对套接字地址简单封装，内部用sockaddr_storage存放，支持AF_INET和AF_UNIX(流式)两种协议族
+ * -将网络字节流转化为字符串，Unix域地址显示为"unix:路径"
+ * -Unix域路径以'@'开头时表示Linux抽象命名空间，不在文件系统中创建文件
  */
 class InetAddress
 {
 public:
-    InetAddress(const sockaddr_in &addr)
-        : addr_(addr) {}
+    InetAddress(const sockaddr_in &addr);
     InetAddress(const uint16_t &port); // 只设置端口时，设置ip地址为通配符
+    InetAddress(const struct sockaddr *addr, socklen_t len);
+    static InetAddress fromUnixPath(const std::string &path);
 
-    std::string toIp() const;
+    sa_family_t family() const { return addr_.ss_family; }
+    bool isUnix() const { return addr_.ss_family == AF_UNIX; }
+    std::string toIp() const;     // Unix域地址返回路径
     std::string toIpPort() const;
-    uint16_t toPort() const;
+    uint16_t toPort() const;      // Unix域地址返回0
+    std::string toUnixPath() const;
 
-    const sockaddr_in *getSockaddr() const { return &addr_; }
-    const sockaddr *getSockaddr() { return const_cast<sockaddr *>(reinterpret_cast<sockaddr *>(&addr_)); }
-    void setSockaddr(const sockaddr_in &addr) { addr_ = addr; }
+    const sockaddr *getSockaddr() const { return reinterpret_cast<const sockaddr *>(&addr_); }
+    socklen_t getSockaddrLen() const { return len_; }
+    void setSockaddr(const struct sockaddr *addr, socklen_t len);
 
 private:
-    struct sockaddr_in addr_;
-};
\ No newline at end of file
+    struct sockaddr_storage addr_;
+    socklen_t len_; // Unix域地址的有效长度随路径变化，bind/connect必须传入实际长度
+};
@@ -0,0 +1,165 @@
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "LogFile.h"
+
+LogFile::LogFile(const std::string &basename, off_t rollSize, bool threadSafe,
+                 int flushInterval, int checkEveryN)
+    : basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushInterval),
+      checkEveryN_(checkEveryN),
+      count_(0),
+      mutex_(threadSafe ? new std::mutex : nullptr),
+      startOfPeriod_(0),
+      lastRoll_(0),
+      lastFlush_(0),
+      fp_(nullptr),
+      writtenBytes_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    if (mutex_)
+    {
+        std::lock_guard<std::mutex> lk(*mutex_);
+        appendUnlocked(logline, len);
+    }
+    else
+    {
+        appendUnlocked(logline, len);
+    }
+}
+
+void LogFile::flush()
+{
+    if (mutex_)
+    {
+        std::lock_guard<std::mutex> lk(*mutex_);
+        if (fp_)
+        {
+            ::fflush(fp_);
+        }
+    }
+    else if (fp_)
+    {
+        ::fflush(fp_);
+    }
+}
+
+void LogFile::appendUnlocked(const char *logline, size_t len)
+{
+    if (fp_ == nullptr && !rollFile())
+    {
+        return; // 文件打不开时丢弃日志，不影响业务线程
+    }
+    size_t written = 0;
+    while (written < len)
+    {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            /* 这里不能再用LOG_*写日志，否则可能递归回到自己 */
+            if (ferror(fp_))
+            {
+                fprintf(stderr, "LogFile::append() failed %s\n", strerror(errno));
+                clearerr(fp_);
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+
+    if (writtenBytes_ > rollSize_)
+    {
+        rollFile();
+    }
+    else if (++count_ >= checkEveryN_)
+    {
+        count_ = 0;
+        time_t now = ::time(NULL);
+        time_t thisPeriod = now / kRollPerSeconds_ * kRollPerSeconds_;
+        if (thisPeriod != startOfPeriod_)
+        {
+            rollFile();
+        }
+        else if (now - lastFlush_ > flushInterval_)
+        {
+            lastFlush_ = now;
+            ::fflush(fp_);
+        }
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+    time_t start = now / kRollPerSeconds_ * kRollPerSeconds_;
+
+    /* 同一秒内文件名相同，不重复滚动 */
+    if (now > lastRoll_)
+    {
+        FILE *fp = ::fopen(filename.c_str(), "ae"); // 'e'即O_CLOEXEC
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "LogFile::rollFile() open %s failed %s\n", filename.c_str(), strerror(errno));
+            return false;
+        }
+        if (fp_)
+        {
+            ::fclose(fp_);
+        }
+        fp_ = fp;
+        ::setbuffer(fp_, buffer_, sizeof(buffer_));
+        lastRoll_ = now;
+        lastFlush_ = now;
+        startOfPeriod_ = start;
+        writtenBytes_ = 0;
+        return true;
+    }
+    return false;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t *now)
+{
+    std::string filename;
+    filename.reserve(basename.size() + 64);
+    filename = basename;
+
+    char timebuf[32];
+    struct tm tm;
+    *now = ::time(NULL);
+    gmtime_r(now, &tm);
+    strftime(timebuf, sizeof(timebuf), ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256];
+    if (::gethostname(hostname, sizeof(hostname)) == 0)
+    {
+        hostname[sizeof(hostname) - 1] = '\0';
+        filename += hostname;
+    }
+    else
+    {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof(pidbuf), ".%d", ::getpid());
+    filename += pidbuf;
+    filename += ".log";
+    return filename;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "noncopyable.h"
+
+/**
+ * 滚动日志文件：
+ * -文件名为 basename.年月日-时分秒.主机名.进程号.log；
+ * -写满rollSize字节或跨过零点(UTC)时换一个新文件；
+ * -用fwrite_unlocked写入64KB的用户态缓冲，每checkEveryN次写入检查一次是否需要滚动，
+ *  距上次刷盘超过flushInterval秒就fflush。
+ * threadSafe为false时由调用者保证只有一个线程写入，AsyncLogging的后台线程即是如此
+ */
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename, off_t rollSize, bool threadSafe = true,
+            int flushInterval = 3, int checkEveryN = 1024);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    bool rollFile();
+
+private:
+    void appendUnlocked(const char *logline, size_t len);
+
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int checkEveryN_;
+
+    int count_;
+    std::unique_ptr<std::mutex> mutex_;
+    time_t startOfPeriod_; // 当前文件所属的那一天(零点的时间戳)
+    time_t lastRoll_;
+    time_t lastFlush_;
+    FILE *fp_;
+    off_t writtenBytes_;
+    char buffer_[64 * 1024];
+
+    static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
@@ -1,4 +1,4 @@
-#include <iostream>
+#include <string.h>
 
 #include "Logger.h"
 #include "Timestamp.h"
@@ -10,17 +10,46 @@ Logger &Logger::instance()
     return logger;
 }
 
-// 设置日志级别
+std::atomic<int> Logger::threshold_(LOG_MIN_LEVEL);
+
+Logger::Logger()
+    : output_(defaultOutput),
+      flush_(defaultFlush)
+{
+}
+
+// 设置日志级别，FATAL总是输出
 void Logger::setLogLevel(int level)
 {
-    logLevel_ = level;
+    threshold_.store(level < FATAL ? level : FATAL, std::memory_order_relaxed);
+}
+
+void Logger::setOutput(const OutputFunc &out)
+{
+    output_ = out ? out : OutputFunc(defaultOutput);
+}
+
+void Logger::setFlush(const FlushFunc &flush)
+{
+    flush_ = flush ? flush : FlushFunc(defaultFlush);
+}
+
+/* stdout接终端时是行缓冲，重定向到文件或管道时是全缓冲，不再每行都刷新 */
+void Logger::defaultOutput(const char *msg, size_t len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+void Logger::defaultFlush()
+{
+    ::fflush(stdout);
 }
 
 // 写日志 [级别信息] time : msg
-void Logger::log(std::string msg)
+void Logger::log(int level, const char *msg)
 {
-    std::string pre = "";
-    switch (logLevel_)
+    const char *pre = "";
+    switch (level)
     {
     case INFO:
         pre = "[INFO]";
@@ -38,6 +67,20 @@ void Logger::log(std::string msg)
         break;
     }
 
-    // 打印时间和msg
-    std::cout << pre + Timestamp::now().toFormattedString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+    // 拼好整行后一次交给输出函数，异步后端只需拷贝一次
+    char line[1152];
+    size_t len = strlen(pre);
+    memcpy(line, pre, len);
+    len += Timestamp::now().formatTo(line + len);
+    memcpy(line + len, " : ", 3);
+    len += 3;
+    size_t msgLen = strnlen(msg, sizeof(line) - len - 1);
+    memcpy(line + len, msg, msgLen);
+    len += msgLen;
+    line[len++] = '\n';
+    output_(line, len);
+    if (level == FATAL)
+    {
+        flush_(); // LOG_FATAL随后会exit()
+    }
+}
@@ -1,76 +1,103 @@
 #pragma once
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include <atomic>
+#include <functional>
 
 #include "noncopyable.h"
+#include "BinaryLogging.h"
 
-// LOG_INFO("%s %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...)                       \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(INFO);                         \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0)
+// 定义日志的级别，数值越大越重要 DEBUG < INFO < ERROR < FATAL
+enum LogLevel
+{
+    DEBUG, // 调试信息
+    INFO,  // 普通信息
+    ERROR, // 错误信息
+    FATAL, // core dump信息
+};
 
-#define LOG_ERROR(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(ERROR);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+/**
+ * 编译期最低级别，低于它的日志语句在编译时就被消除(参数仍做类型检查，但不会求值)，
+ * 例如 -DLOG_MIN_LEVEL=2 只保留ERROR和FATAL。
+ * 未指定时沿用MUDEBUG的约定：定义了MUDEBUG才编译DEBUG日志
+ */
+#ifndef LOG_MIN_LEVEL
+#ifdef MUDEBUG
+#define LOG_MIN_LEVEL 0
+#else
+#define LOG_MIN_LEVEL 1
+#endif
+#endif
+
+/*
+ * 先检查编译期和运行期的级别，被过滤掉的日志不会格式化；
+ * 启用了BinaryLogging时只记录原始参数，由后台线程格式化，FATAL总是同步输出
+ */
+#define LOG_BASE(level, logmsgFormat, ...)                                      \
+    do                                                                          \
+    {                                                                           \
+        if ((level) >= LOG_MIN_LEVEL && (level) >= Logger::logLevel())          \
+        {                                                                       \
+            BinaryLogging *binlog = BinaryLogging::active();                    \
+            if (binlog != nullptr && (level) != FATAL)                          \
+            {                                                                   \
+                binlog->log(level, logmsgFormat, ##__VA_ARGS__);                \
+            }                                                                   \
+            else                                                                \
+            {                                                                   \
+                char buf[1024];                                                 \
+                snprintf(buf, sizeof(buf), logmsgFormat, ##__VA_ARGS__);        \
+                Logger::instance().log(level, buf);                             \
+            }                                                                   \
+        }                                                                       \
     } while (0)
 
+// LOG_INFO("%s %d", arg1, arg2)
+#define LOG_INFO(logmsgFormat, ...) LOG_BASE(INFO, logmsgFormat, ##__VA_ARGS__)
+
+#define LOG_ERROR(logmsgFormat, ...) LOG_BASE(ERROR, logmsgFormat, ##__VA_ARGS__)
+
 #define LOG_FATAL(logmsgFormat, ...)                      \
     do                                                    \
     {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(FATAL);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+        LOG_BASE(FATAL, logmsgFormat, ##__VA_ARGS__);     \
         exit(-1);                                         \
     } while (0)
 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(DEBUG);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0)
-#else
-#define LOG_DEBUG(logmsgFormat, ...)
-#endif
-
-// 定义日志的级别 INFO ERROR FATAL DEBUG
-enum LogLevel
-{
-    INFO,  // 普通信息
-    ERROR, // 错误信息
-    FATAL, // core dump信息
-    DEBUG, // 调试信息
-};
+#define LOG_DEBUG(logmsgFormat, ...) LOG_BASE(DEBUG, logmsgFormat, ##__VA_ARGS__)
 
 // 输出一个日志类
 
 class Logger : noncopyable
 {
 public:
+    /* 输出一行完整的日志(含换行)，默认写stdout，可换成AsyncLogging::append等 */
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
     // 获取日志唯一的实例对象 单例
     static Logger &instance();
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
+
+    /* 运行期的全局级别，任意线程可随时修改，低于它的日志在格式化之前就被丢弃 */
+    static int logLevel() { return threshold_.load(std::memory_order_relaxed); }
+    static void setLogLevel(int level);
+
+    // 写日志，级别由调用者传入，不再依赖单例上的可变状态
+    void log(int level, const char *msg);
+
+    /* 在其他线程开始写日志之前设置，传空函数即恢复默认 */
+    void setOutput(const OutputFunc &out);
+    void setFlush(const FlushFunc &flush);
+
+    static void defaultOutput(const char *msg, size_t len);
+    static void defaultFlush();
 
 private:
-    int logLevel_;
-};
\ No newline at end of file
+    Logger();
+
+    static std::atomic<int> threshold_;
+    OutputFunc output_;
+    FlushFunc flush_;
+};
@@ -38,7 +38,7 @@ Timestamp PollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 /*
     只有在channel要注册事件的时候才添加pollfd，
     或更改事件时修改pollfd
-    添加到channels_时复杂度为O(logN),修改时复杂度为O(1)
+    添加到channels_和修改时复杂度均为O(1)
 */
 void PollPoller::updateChannel(Channel *channel)
 {
@@ -47,7 +47,7 @@ void PollPoller::updateChannel(Channel *channel)
     if (channel->index() < 0)
     {
         // channel注册事件监听——包括添加pollfd，添加<fd,channel>记录到channels_中
-        assert(channels_.find(channel->fd()) == channels_.end() && "检查channel对应的pollfd不存在");
+        assert(findChannel(channel->fd()) == nullptr && "检查channel对应的pollfd不存在");
         struct pollfd pfd;
         pfd.fd = channel->fd();
         pfd.events = static_cast<short>(channel->events()); // pollfd::events的数据类型是short
@@ -55,13 +55,12 @@ void PollPoller::updateChannel(Channel *channel)
         pollfds_.push_back(pfd);
         int idx = static_cast<int>(pollfds_.size()) - 1;
         channel->set_index(idx);
-        channels_[pfd.fd] = channel;
+        addChannel(channel);
     }
     else
     {
         // channel修改事件监听
-        assert(channels_.find(channel->fd()) != channels_.end() && "检查channel对应的pollfd存在");
-        assert(channels_[channel->fd()] == channel && "检查fd和channel是否对应");
+        assert(findChannel(channel->fd()) == channel && "检查channel对应的pollfd存在且fd和channel对应");
         int idx = channel->index();
         assert(0 <= idx && idx < static_cast<int>(pollfds_.size()) && "检查idx是否在pollfds范围内");
         struct pollfd &pfd = pollfds_[idx];
@@ -79,16 +78,13 @@ void PollPoller::updateChannel(Channel *channel)
 void PollPoller::removeChannel(Channel *channel)
 {
     assertInLoopThread();
-    LOG_DEBUG("fd = ", channel->fd());
-    assert(channels_.find(channel->fd()) != channels_.end() && "确认channel的fd是否在channelMap中存在");
-    assert(channels_[channel->fd()] == channel && "确认channelMap中的值是否和channel对应");
+    LOG_DEBUG("fd = %d", channel->fd());
+    assert(findChannel(channel->fd()) == channel && "确认channel的fd在channelMap中存在且和channel对应");
     assert(channel->isNoneEvents() && "移除channel前该channel值必须为kNoneEvents");
     int idx = channel->index();
     const struct pollfd &pfd = pollfds_[idx];
     assert(pfd.fd == -channel->fd() - 1 && pfd.events == channel->events() && "检验该pollfd的fd和events是否和channel的一一对应");
-    ssize_t n = channels_.erase(channel->fd());
-    assert(n == 1);
-    (void)n; // 消除编译器发出的未使用变量n的警告
+    eraseChannel(channel->fd());
     // 删除在vector中删除pollfd的办法是将该pollfd置换到末尾再popback
     if (static_cast<size_t>(idx) != pollfds_.size() - 1)
     {
@@ -102,7 +98,7 @@ void PollPoller::removeChannel(Channel *channel)
     pollfds_.pop_back();
 }
 
-// 遍历活跃描述符集合pollfds_，然后根据无序map<fd,channel*>channels_，设置revents值，将channel指针填充进activeChannels
+// 遍历活跃描述符集合pollfds_，然后根据以fd为下标的channels_，设置revents值，将channel指针填充进activeChannels
 // 本质上是将活跃描述符转化为活跃channel对象
 // 复杂度为O(N)
 void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
@@ -113,9 +109,8 @@ void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
         if (pfd->revents > 0)
         {
             numEvents--;
-            ChannelMap::const_iterator ch = channels_.find(pfd->fd);
-            assert(ch != channels_.end()); // 如果找不到，返回end迭代器
-            Channel *channel = ch->second;
+            Channel *channel = channels_[pfd->fd];
+            assert(channel != nullptr); // 活跃的pollfd必然有对应的channel
             assert(channel->fd() == pfd->fd); // 检查invariant
             channel->set_revents(pfd->revents);
             // 不必手动重置pfd->revents为0，因为每次调用poll()时都会重置pfd->revents
@@ -1,7 +1,24 @@
+#include <algorithm>
 
 #include "Poller.h"
+#include "Channel.h"
 
 Poller::Poller(EventLoop *loop)
     : ownerLoop_(loop)
 {
 }
+
+bool Poller::hasChannel(Channel *channel) const
+{
+    return findChannel(channel->fd()) == channel;
+}
+
+void Poller::addChannel(Channel *channel)
+{
+    size_t fd = static_cast<size_t>(channel->fd());
+    if (fd >= channels_.size())
+    {
+        channels_.resize(std::max(fd + 1, 2 * channels_.size()), nullptr);
+    }
+    channels_[fd] = channel;
+}
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 #include <poll.h>
 
 #include "EventLoop.h"
@@ -24,20 +23,30 @@ public:
 
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
-    // virtual bool hasChannel() const;
+    bool hasChannel(Channel *channel) const;
 
     static Poller *newDefaultPoller(EventLoop *loop);
     void assertInLoopThread() { ownerLoop_->assertInLoopThread(); }
 
 protected:
-    using ChannelMap = std::unordered_map<int, Channel *>;
+    /* 以fd为下标的稠密数组，空位为nullptr；内核总是分配最小可用的fd，所以数组不会过于稀疏 */
+    using ChannelMap = std::vector<Channel *>;
+
+    /* 查找fd对应的Channel，不存在则返回nullptr，复杂度O(1) */
+    Channel *findChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+    /* 按需成倍扩容后记录<fd,Channel>，避免map的树查找和节点分配 */
+    void addChannel(Channel *channel);
+    void eraseChannel(int fd) { channels_[fd] = nullptr; }
 
     /**
      *  对于channels_,
      *  在EpollPoller仅仅用来断言确认Channel和fd的存在和对应关系
      *  在PollPoller中方便寻找活跃fd和Channel，因为Poll会返回所有描述符，需要自己查找
     */
-    ChannelMap channels_; 
+    ChannelMap channels_;
 
 
 private:
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <assert.h>
+
+#include "noncopyable.h"
+
+/**
+ * 以64位id为键的slot map：
+ * -id的低32位是槽位下标，高32位是该槽位的代数(generation)；
+ * -槽位被释放时代数加一，过期的id再来查找或删除时代数对不上，不会误中复用该槽位的新对象；
+ * -空闲槽位通过下标串成单链表复用，插入、查找、删除都是O(1)，既不哈希也不分配节点。
+ * 非线程安全，由持有者负责加锁或限定在单个线程中使用
+ */
+template <typename T>
+class SlotMap : noncopyable
+{
+public:
+    using Id = uint64_t;
+    static const Id kInvalidId = 0; // 代数从1开始，合法id不会为0
+
+    SlotMap()
+        : freeHead_(kNoFreeSlot),
+          size_(0)
+    {
+    }
+
+    Id insert(T value)
+    {
+        uint32_t index;
+        if (freeHead_ != kNoFreeSlot)
+        {
+            index = freeHead_;
+            freeHead_ = slots_[index].nextFree;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+        Slot &slot = slots_[index];
+        assert(!slot.occupied);
+        slot.value = std::move(value);
+        slot.occupied = true;
+        size_++;
+        return makeId(index, slot.generation);
+    }
+
+    /* id过期或不存在时返回nullptr */
+    T *find(Id id)
+    {
+        uint32_t index = indexOf(id);
+        if (index >= slots_.size())
+        {
+            return nullptr;
+        }
+        Slot &slot = slots_[index];
+        return slot.occupied && slot.generation == generationOf(id) ? &slot.value : nullptr;
+    }
+
+    bool erase(Id id)
+    {
+        if (find(id) == nullptr)
+        {
+            return false;
+        }
+        uint32_t index = indexOf(id);
+        Slot &slot = slots_[index];
+        slot.value = T(); // 立即释放所持有的资源
+        slot.occupied = false;
+        slot.generation++;
+        if (slot.generation == 0) // 回绕时跳过0，保证kInvalidId永远无效
+        {
+            slot.generation = 1;
+        }
+        slot.nextFree = freeHead_;
+        freeHead_ = index;
+        size_--;
+        return true;
+    }
+
+    /* 遍历所有存活的元素，回调中不能插入或删除 */
+    template <typename Func>
+    void forEach(Func func)
+    {
+        for (Slot &slot : slots_)
+        {
+            if (slot.occupied)
+            {
+                func(slot.value);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static const uint32_t kNoFreeSlot = UINT32_MAX;
+
+    struct Slot
+    {
+        T value;
+        uint32_t generation = 1;
+        uint32_t nextFree = kNoFreeSlot;
+        bool occupied = false;
+    };
+
+    static Id makeId(uint32_t index, uint32_t generation)
+    {
+        return (static_cast<Id>(generation) << 32) | index;
+    }
+    static uint32_t indexOf(Id id) { return static_cast<uint32_t>(id); }
+    static uint32_t generationOf(Id id) { return static_cast<uint32_t>(id >> 32); }
+
+    std::vector<Slot> slots_;
+    uint32_t freeHead_;
+    size_t size_;
+};
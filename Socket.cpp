@@ -11,11 +11,23 @@ Socket::~Socket()
     Socket::close(sockfd_);
 }
 
-int Socket::createNonblocking()
+int Socket::createNonblocking(sa_family_t family)
 {
-    int sockfd = ::socket(AF_INET,
+    int sockfd = ::socket(family,
                           SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
-                          IPPROTO_TCP);
+                          family == AF_UNIX ? 0 : IPPROTO_TCP);
+    if (sockfd < 0)
+    {
+        LOG_ERROR("socket() failed");
+    }
+    return sockfd;
+}
+
+int Socket::createNonblockingDatagram(sa_family_t family)
+{
+    int sockfd = ::socket(family,
+                          SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          family == AF_UNIX ? 0 : IPPROTO_UDP);
     if (sockfd < 0)
     {
         LOG_ERROR("socket() failed");
@@ -25,7 +37,7 @@ int Socket::createNonblocking()
 
 void Socket::bindAddress(const InetAddress &address)
 {
-    if (::bind(sockfd_, (sockaddr *)address.getSockaddr(), sizeof(sockaddr_in)))
+    if (::bind(sockfd_, address.getSockaddr(), address.getSockaddrLen()))
     {
         LOG_FATAL("bind() sockfd%d failed", sockfd_);
     }
@@ -41,21 +53,20 @@ void Socket::listen()
 
 int Socket::accept(InetAddress *peerAddress)
 {
-    struct sockaddr_in addr;
+    struct sockaddr_storage addr;
     memset(&addr, 0, sizeof(addr));
     socklen_t len = sizeof(addr);
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0)
     {
-        peerAddress->setSockaddr(addr);
+        peerAddress->setSockaddr((sockaddr *)&addr, len);
     }
     else
     {
         int savedErrno = errno;
-        LOG_FATAL("Socket::accept");
         switch (savedErrno)
         {
-        case EAGAIN:
+        case EAGAIN: // 非阻塞监听套接字的已完成连接队列为空，属于正常情况
         case ECONNABORTED:
         case EINTR:
         case EPROTO:
@@ -97,35 +108,41 @@ void Socket::close(int sockfd)
     }
 }
 
-sockaddr_in Socket::getLocalAddr(int sockfd)
+InetAddress Socket::getLocalAddr(int sockfd)
 {
-    struct sockaddr_in localAddr;
+    struct sockaddr_storage localAddr;
     memset(&localAddr, 0, sizeof(localAddr));
     socklen_t len = sizeof(localAddr);
     if (::getsockname(sockfd, (sockaddr *)&localAddr, &len) < 0)
     {
         LOG_ERROR("Socket::getLocalAddr");
     }
-    return localAddr;
+    return InetAddress((sockaddr *)&localAddr, len);
 }
 
-sockaddr_in Socket::getPeerAddr(int sockfd)
+InetAddress Socket::getPeerAddr(int sockfd)
 {
-    struct sockaddr_in peerAddr;
+    struct sockaddr_storage peerAddr;
     socklen_t len = sizeof(peerAddr);
     memset(&peerAddr, 0, sizeof(peerAddr));
     if (::getpeername(sockfd, (sockaddr *)&peerAddr, &len) < 0)
     {
         LOG_ERROR("Socket::getPeerAddr");
     }
-    return peerAddr;
+    return InetAddress((sockaddr *)&peerAddr, len);
 }
 
 bool Socket::isSelfConnection(int sockfd)
 {
-    struct sockaddr_in localAddr = Socket::getLocalAddr(sockfd);
-    struct sockaddr_in peerAddr = Socket::getPeerAddr(sockfd);
-    return localAddr.sin_addr.s_addr == peerAddr.sin_addr.s_addr && localAddr.sin_port == peerAddr.sin_port;
+    /* 只有TCP会因为临时端口与监听端口相同而自连接 */
+    InetAddress localAddr = Socket::getLocalAddr(sockfd);
+    if (localAddr.family() != AF_INET)
+    {
+        return false;
+    }
+    InetAddress peerAddr = Socket::getPeerAddr(sockfd);
+    return localAddr.getSockaddrLen() == peerAddr.getSockaddrLen() &&
+           ::memcmp(localAddr.getSockaddr(), peerAddr.getSockaddr(), localAddr.getSockaddrLen()) == 0;
 }
 
 int Socket::getSocketError(int sockfd)
@@ -1,8 +1,9 @@
 #pragma once
 
 #include <netinet/ip.h>
+#include <sys/socket.h>
 
-class InetAddress;
+#include "InetAddress.h"
 
 /* 封装服务器各自用于操作连接的接口(bind, listen, accept and close)，
  * 还有一些套接字选项(TCP_NODELAY,SO_REUSEADDR,SO_REUSEPORT,SO_KEEPALIVE)
@@ -20,18 +21,19 @@ public:
     int fd() const { return sockfd_; }
     void bindAddress(const InetAddress &address); // 封装bind()
     void listen();                                // 封装listen()
-    int accept(InetAddress *peerAddress);         // 封装accept()并处理一些异常情况
+    int accept(InetAddress *peerAddress);         // 封装accept4()，可恢复的错误(EAGAIN/EMFILE等)返回-1并保留errno
 
     /* 剩下的静态函数是不必由独立对象调用，通过fd直接调用即可 */
-    static int createNonblocking(); // 封装socket()创建非阻塞描述符
+    static int createNonblocking(sa_family_t family = AF_INET); // 封装socket()创建非阻塞的流式描述符，支持AF_INET和AF_UNIX
+    static int createNonblockingDatagram(sa_family_t family = AF_INET); // 创建非阻塞的数据报描述符
     static void shutdownWrite(int sockfd);
     static void close(int sockfd);
-    static struct sockaddr_in getLocalAddr(int sockfd);
-    static struct sockaddr_in getPeerAddr(int sockfd);
+    static InetAddress getLocalAddr(int sockfd);
+    static InetAddress getPeerAddr(int sockfd);
     static int getSocketError(int sockfd);
     static bool isSelfConnection(int sockfd);
 
-    void setTcpNoDelay(bool on);
+    void setTcpNoDelay(bool on); // 对Unix域套接字无效，setsockopt()失败时忽略
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
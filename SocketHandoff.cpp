@@ -0,0 +1,210 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+
+#include "SocketHandoff.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+namespace
+{
+    /* 每条消息的正文：SCM_RIGHTS在流式套接字上必须附带至少一个字节的正文 */
+    struct MessageHeader
+    {
+        uint32_t kind;
+        uint32_t count;
+    };
+
+    bool fillUnixAddr(const std::string &path, struct sockaddr_un *addr)
+    {
+        memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr->sun_path))
+        {
+            LOG_ERROR("SocketHandoff path too long: %s", path.c_str());
+            return false;
+        }
+        ::strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+        return true;
+    }
+}
+
+SocketHandoff::SocketHandoff(EventLoop *loop, const std::string &path)
+    : loop_(loop),
+      path_(path),
+      listenFd_(::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)),
+      channel_(loop, listenFd_),
+      handedOff_(false)
+{
+    if (listenFd_ < 0)
+    {
+        LOG_FATAL("SocketHandoff::socket() failed");
+    }
+    channel_.setReadCallback(std::bind(&SocketHandoff::handleRead, this));
+}
+
+SocketHandoff::~SocketHandoff()
+{
+    if (!channel_.isNoneEvents())
+    {
+        channel_.disableAll();
+        channel_.remove();
+    }
+    ::close(listenFd_);
+}
+
+void SocketHandoff::listen()
+{
+    loop_->assertInLoopThread();
+    struct sockaddr_un addr;
+    if (!fillUnixAddr(path_, &addr))
+    {
+        LOG_FATAL("SocketHandoff::listen() invalid path");
+    }
+    ::unlink(path_.c_str()); // 上一代进程留下的路径
+    if (::bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listenFd_, 4) < 0)
+    {
+        LOG_FATAL("SocketHandoff::listen() on %s failed", path_.c_str());
+    }
+    channel_.enableReading();
+}
+
+void SocketHandoff::handleRead()
+{
+    loop_->assertInLoopThread();
+    int connfd = ::accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC); // 控制连接用阻塞模式，便于按顺序发送
+    if (connfd < 0)
+    {
+        return;
+    }
+    if (handedOff_)
+    {
+        ::close(connfd);
+        return;
+    }
+    struct timeval timeout = {1, 0}; // 新进程卡住时不要拖住旧进程的IO线程
+    ::setsockopt(connfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    Sockets sockets;
+    if (collectCb_)
+    {
+        collectCb_(&sockets);
+    }
+    bool ok = sendFds(connfd, kListenFds, sockets.listenFds) &&
+              sendFds(connfd, kConnFds, sockets.connFds) &&
+              sendFds(connfd, kDone, std::vector<int>());
+    ::close(connfd);
+    if (!ok)
+    {
+        LOG_ERROR("SocketHandoff::handleRead() failed to hand off sockets on %s", path_.c_str());
+        return;
+    }
+
+    LOG_INFO("SocketHandoff handed off %zu listening sockets and %zu connections on %s",
+             sockets.listenFds.size(), sockets.connFds.size(), path_.c_str());
+    handedOff_ = true;
+    channel_.disableAll();
+    channel_.remove();
+    if (handedOffCb_)
+    {
+        handedOffCb_();
+    }
+}
+
+bool SocketHandoff::sendFds(int sockfd, MessageKind kind, const std::vector<int> &fds)
+{
+    size_t sent = 0;
+    do
+    {
+        size_t n = std::min(fds.size() - sent, static_cast<size_t>(kMaxFdsPerMessage));
+        MessageHeader header = {static_cast<uint32_t>(kind), static_cast<uint32_t>(n)};
+        struct iovec iov = {&header, sizeof(header)};
+        char control[CMSG_SPACE(sizeof(int) * kMaxFdsPerMessage)];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (n > 0)
+        {
+            memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * n);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n);
+            memcpy(CMSG_DATA(cmsg), fds.data() + sent, sizeof(int) * n);
+        }
+        if (::sendmsg(sockfd, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(header)))
+        {
+            return false;
+        }
+        sent += n;
+    } while (sent < fds.size());
+    return true;
+}
+
+bool SocketHandoff::receive(const std::string &path, Sockets *sockets)
+{
+    struct sockaddr_un addr;
+    if (!fillUnixAddr(path, &addr))
+    {
+        return false;
+    }
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0 || ::connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        if (sockfd >= 0)
+        {
+            ::close(sockfd);
+        }
+        return false; // 没有旧进程，由调用者自己bind
+    }
+
+    bool done = false;
+    while (!done)
+    {
+        MessageHeader header;
+        struct iovec iov = {&header, sizeof(header)};
+        char control[CMSG_SPACE(sizeof(int) * kMaxFdsPerMessage)];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+        if (n != static_cast<ssize_t>(sizeof(header)))
+        {
+            LOG_ERROR("SocketHandoff::receive() truncated message from %s", path.c_str());
+            break;
+        }
+
+        std::vector<int> *target = header.kind == kListenFds ? &sockets->listenFds : &sockets->connFds;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int *fds = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+                target->insert(target->end(), fds, fds + count);
+            }
+        }
+        done = header.kind == kDone;
+    }
+    ::close(sockfd);
+    if (!done)
+    {
+        for (int fd : sockets->listenFds)
+            ::close(fd);
+        for (int fd : sockets->connFds)
+            ::close(fd);
+        sockets->listenFds.clear();
+        sockets->connFds.clear();
+    }
+    return done && !sockets->listenFds.empty();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+
+#include "Channel.h"
+#include "noncopyable.h"
+
+class EventLoop;
+
+/**
+ * 进程间移交套接字，实现不中断服务的重启：
+ * -旧进程在Unix域套接字path上监听接管请求(listen())；
+ * -新进程调用receive()连接path，旧进程通过SCM_RIGHTS把监听套接字(和可选的存活连接)传给新进程；
+ * -两个进程持有的是同一个内核套接字，已完成连接队列中的连接不会丢失，客户端不会看到连接被拒绝；
+ * -旧进程交出描述符后执行handedOff回调，由持有者负责停止accept并优雅地关闭已有连接。
+ */
+class SocketHandoff : noncopyable
+{
+public:
+    struct Sockets
+    {
+        std::vector<int> listenFds; // 监听套接字，第一个为主监听套接字
+        std::vector<int> connFds;   // 存活连接
+    };
+    using CollectCallback = std::function<void(Sockets *)>; // 收集需要交出的描述符
+    using HandedOffCallback = std::function<void()>;        // 描述符全部发出后调用
+
+    SocketHandoff(EventLoop *loop, const std::string &path);
+    ~SocketHandoff();
+
+    void setCollectCallback(const CollectCallback &cb) { collectCb_ = std::move(cb); }
+    void setHandedOffCallback(const HandedOffCallback &cb) { handedOffCb_ = std::move(cb); }
+    void listen(); // 删除旧的同名文件后bind并监听，必须在loop线程中调用
+
+    /* 新进程调用(阻塞)：没有旧进程在path上监听时返回false，收到的描述符都带有FD_CLOEXEC */
+    static bool receive(const std::string &path, Sockets *sockets);
+
+private:
+    enum MessageKind
+    {
+        kListenFds = 1,
+        kConnFds,
+        kDone,
+    };
+    static const int kMaxFdsPerMessage = 64; // 每条消息附带的描述符上限(内核上限SCM_MAX_FD为253)
+
+    void handleRead(); // 接收到接管请求，发送描述符后关闭控制连接
+    static bool sendFds(int sockfd, MessageKind kind, const std::vector<int> &fds);
+
+    EventLoop *loop_;
+    const std::string path_;
+    int listenFd_;
+    Channel channel_;
+    bool handedOff_; // 只移交一次
+    CollectCallback collectCb_;
+    HandedOffCallback handedOffCb_;
+};
@@ -98,6 +98,7 @@ void TcpClient::newConnection(int sockfd)
                                                           peerAddr));
     conn->setConnectionCallback(connCb_);
     conn->setMessageCallback(messaCb_);
+    conn->setWriteCompleteCallback(wriComCb_);
     conn->setCloseCallback(std::bind(
         &TcpClient::removeConnection, this, _1));
 
@@ -27,6 +27,11 @@ public:
     void disconnect(); // 半关闭连接，待服务器知晓后就可以移除连接
     void stop();       // 注销定时器，停止尝试连接
     bool retry() const { return retry_; }
+    TcpConnectionPtr connection()
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return connection_;
+    }
     void enableRetry() { retry_ = true; }
 
     void setConnectionCallback(const ConnectionCallback &cb)
@@ -0,0 +1,212 @@
+#include <assert.h>
+#include <future>
+
+#include "TcpClientPool.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+using namespace std::placeholders;
+
+/* 换掉连接上指向池的回调，池析构后连接仍可能在自己的loop中收尾 */
+static void detachConnection(const TcpConnectionPtr &conn)
+{
+    if (conn)
+    {
+        conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+        conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                                 { buf->retrieveAll(); });
+        conn->setWriteCompleteCallback(WriteCompleteCallback());
+    }
+}
+
+TcpClientPool::TcpClientPool(EventLoopThreadPool *threadPool, const InetAddress &serverAddr, const std::string &name)
+    : threadPool_(threadPool),
+      serverAddr_(serverAddr),
+      name_(name),
+      connectionsPerLoop_(kDefaultConnectionsPerLoop),
+      started_(false),
+      next_(0),
+      numConnected_(0)
+{
+}
+
+TcpClientPool::~TcpClientPool()
+{
+    stop();
+    /**
+     * 连接最后的断开回调绑定着LoopClients，TcpConnection和Connector也只能在所属loop中注销Channel，
+     * 所以逐个loop同步地换掉回调、析构TcpClient，之后才能释放LoopClients
+     */
+    for (const auto &clients : loops_)
+    {
+        std::promise<void> done;
+        LoopClients *lc = clients.get();
+        lc->loop->runInLoop([lc, &done]()
+                            {
+                                for (Entry &entry : lc->entries)
+                                {
+                                    /* 正在关闭的连接已经不在TcpClient中，但其connDestroyed()还没有执行 */
+                                    detachConnection(entry.conn);
+                                    detachConnection(entry.client->connection());
+                                    {
+                                        /* 先放下池对连接的引用，TcpClient析构时发现自己是唯一持有者才会关闭连接 */
+                                        std::lock_guard<std::mutex> lk(lc->mutex);
+                                        entry.conn.reset();
+                                    }
+                                    entry.client.reset();
+                                }
+                                done.set_value(); });
+        done.get_future().wait();
+    }
+}
+
+void TcpClientPool::start()
+{
+    assert(!started_);
+    started_ = true;
+    for (EventLoop *loop : threadPool_->getAllLoops())
+    {
+        auto clients = std::make_unique<LoopClients>();
+        clients->loop = loop;
+        clients->entries.resize(connectionsPerLoop_);
+        for (size_t i = 0; i < clients->entries.size(); ++i)
+        {
+            Entry &entry = clients->entries[i];
+            entry.outstanding = 0;
+            entry.client = std::make_unique<TcpClient>(loop, serverAddr_,
+                                                       name_ + "-" + std::to_string(loops_.size()) + "-" + std::to_string(i));
+            entry.client->setConnectionCallback(std::bind(&TcpClientPool::onConnection, this, clients.get(), i, _1));
+            entry.client->setMessageCallback(messaCb_);
+            if (wriComCb_)
+            {
+                entry.client->setWriteCompleteCallback(wriComCb_);
+            }
+            entry.client->enableRetry(); // 断开后由Connector按退避时间重连
+        }
+        loopIndex_[loop] = clients.get();
+        loops_.push_back(std::move(clients));
+    }
+
+    /* 所有结构建好后再发起连接，回调中不会看到半成品 */
+    for (const auto &clients : loops_)
+    {
+        for (Entry &entry : clients->entries)
+        {
+            entry.client->connect();
+        }
+    }
+    LOG_INFO("TcpClientPool::start[%s] %d connections per loop to %s on %zu loops", name_.c_str(),
+             connectionsPerLoop_, serverAddr_.toIpPort().c_str(), loops_.size());
+}
+
+void TcpClientPool::stop()
+{
+    for (const auto &clients : loops_)
+    {
+        for (Entry &entry : clients->entries)
+        {
+            entry.client->stop();
+            entry.client->disconnect();
+        }
+    }
+}
+
+void TcpClientPool::onConnection(LoopClients *clients, size_t index, const TcpConnectionPtr &conn)
+{
+    clients->loop->assertInLoopThread();
+    {
+        std::lock_guard<std::mutex> lk(clients->mutex);
+        Entry &entry = clients->entries[index];
+        if (conn->connected())
+        {
+            entry.conn = conn;
+            entry.outstanding = 0;
+            numConnected_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (entry.conn == conn)
+        {
+            /* 断开时未完成的请求随连接一起作废 */
+            entry.conn.reset();
+            entry.outstanding = 0;
+            numConnected_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    if (connCb_)
+    {
+        connCb_(conn);
+    }
+}
+
+TcpConnectionPtr TcpClientPool::acquireFrom(LoopClients *clients)
+{
+    std::lock_guard<std::mutex> lk(clients->mutex);
+    Entry *best = nullptr;
+    for (Entry &entry : clients->entries)
+    {
+        if (entry.conn && entry.conn->connected() && (best == nullptr || entry.outstanding < best->outstanding))
+        {
+            best = &entry;
+        }
+    }
+    if (best == nullptr)
+    {
+        return TcpConnectionPtr();
+    }
+    best->outstanding++;
+    return best->conn;
+}
+
+TcpConnectionPtr TcpClientPool::acquire()
+{
+    if (loops_.empty())
+    {
+        return TcpConnectionPtr();
+    }
+    /* 优先使用调用者所在loop上的连接，send()可以直接在本线程完成 */
+    auto it = loopIndex_.find(EventLoop::getEventLoopOfCurrentThread());
+    if (it != loopIndex_.end())
+    {
+        TcpConnectionPtr conn = acquireFrom(it->second);
+        if (conn)
+        {
+            return conn;
+        }
+    }
+
+    size_t n = loops_.size();
+    unsigned start = next_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i)
+    {
+        TcpConnectionPtr conn = acquireFrom(loops_[(start + i) % n].get());
+        if (conn)
+        {
+            return conn;
+        }
+    }
+    return TcpConnectionPtr();
+}
+
+void TcpClientPool::release(const TcpConnectionPtr &conn)
+{
+    auto it = loopIndex_.find(conn->getLoop());
+    if (it == loopIndex_.end())
+    {
+        return;
+    }
+    LoopClients *clients = it->second;
+    std::lock_guard<std::mutex> lk(clients->mutex);
+    for (Entry &entry : clients->entries)
+    {
+        if (entry.conn == conn)
+        {
+            if (entry.outstanding > 0)
+            {
+                entry.outstanding--;
+            }
+            return;
+        }
+    }
+}
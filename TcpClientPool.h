@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Callbacks.h"
+#include "InetAddress.h"
+#include "noncopyable.h"
+
+class EventLoop;
+class EventLoopThreadPool;
+class TcpClient;
+
+/**
+ * 面向同一个上游的连接池：
+ * -在线程池的每个loop上各保持connectionsPerLoop条长连接，断开后由Connector按退避时间自动重连；
+ * -acquire()优先返回调用者所在loop上未完成请求最少的连接，调用者可以直接send()而不必跨线程；
+ *  调用者不在池中的loop上时，轮询选择一个loop；
+ * -池不理解协议，acquire()把该连接的未完成请求数加一，调用者收到应答后调用release()减一。
+ * 线程池必须先于start()启动，并且比TcpClientPool活得更久
+ */
+class TcpClientPool : noncopyable
+{
+public:
+    static const int kDefaultConnectionsPerLoop = 2;
+
+    TcpClientPool(EventLoopThreadPool *threadPool, const InetAddress &serverAddr, const std::string &name);
+    ~TcpClientPool();
+
+    /* 以下设置需要在start()之前调用 */
+    void setConnectionsPerLoop(int n) { connectionsPerLoop_ = n > 0 ? n : 1; }
+    void setConnectionCallback(const ConnectionCallback &cb) { connCb_ = std::move(cb); }
+    void setMessageCallback(const MessageCallback &cb) { messaCb_ = std::move(cb); }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { wriComCb_ = std::move(cb); }
+
+    void start(); // 在线程池的baseLoop中调用
+    void stop();  // 停止重连并半关闭所有连接
+
+    /* 线程安全，没有可用连接时返回空指针 */
+    TcpConnectionPtr acquire();
+    void release(const TcpConnectionPtr &conn);
+    int numConnected() const { return numConnected_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<TcpClient> client;
+        TcpConnectionPtr conn; // 由所属loop在连接建立和断开时更新
+        int outstanding;       // 已acquire()但尚未release()的请求数
+    };
+    /* 一个loop上的所有连接，mutex只在跨线程acquire()时才有竞争 */
+    struct LoopClients
+    {
+        EventLoop *loop;
+        std::mutex mutex;
+        std::vector<Entry> entries;
+    };
+
+    void onConnection(LoopClients *clients, size_t index, const TcpConnectionPtr &conn);
+    TcpConnectionPtr acquireFrom(LoopClients *clients);
+
+    EventLoopThreadPool *threadPool_;
+    const InetAddress serverAddr_;
+    const std::string name_;
+    int connectionsPerLoop_;
+    bool started_;
+    ConnectionCallback connCb_;
+    MessageCallback messaCb_;
+    WriteCompleteCallback wriComCb_;
+    std::vector<std::unique_ptr<LoopClients>> loops_;           // start()之后不再改变
+    std::unordered_map<EventLoop *, LoopClients *> loopIndex_; // 由loop找到其连接
+    std::atomic<unsigned> next_;                               // 池外线程轮询选择loop
+    std::atomic<int> numConnected_;
+};
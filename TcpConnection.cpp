@@ -8,22 +8,47 @@
 #include "TimerId.h"
 
 TcpConnection::TcpConnection(EventLoop *loop, std::string name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
+    : TcpConnection(loop, 0, nullptr, sockfd, localAddr, peerAddr)
+{
+    name_ = std::move(name);
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id, std::shared_ptr<const std::string> namePrefix, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
     : loop_(loop),
+      id_(id),
+      namePrefix_(std::move(namePrefix)),
       socket_(std::make_unique<Socket>(sockfd)),
-      name_(name),
       state_(kConnecting),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
       channel_(std::make_unique<Channel>(loop, sockfd))
 {
-    LOG_DEBUG("TcpConnection::ctor[%s] at %lu fd=%d", name_.c_str(), this, channel_->fd());
+    LOG_DEBUG("TcpConnection::ctor[%lu] at %p fd=%d", id_, this, channel_->fd());
     channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
+    loop_->incConnections(); // 创建时就计入，避免一批连接在建立前都被分给同一个loop
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_DEBUG("TcpConnection::dtor[%s] at %lu fd=%d", name_.c_str(), this, channel_->fd());
+    LOG_DEBUG("TcpConnection::dtor[%lu] at %p fd=%d", id_, this, channel_->fd());
+}
+
+const std::string &TcpConnection::name() const
+{
+    /* 可能被多个线程同时第一次调用，用call_once保证只格式化一次 */
+    std::call_once(nameOnce_, [this]
+                   {
+        if (namePrefix_)
+        {
+            name_ = *namePrefix_ + "#" + std::to_string(id_);
+        } });
+    return name_;
+}
+
+int TcpConnection::fd() const
+{
+    return socket_->fd();
 }
 
 void TcpConnection::send(const void *message, size_t len)
@@ -64,6 +89,51 @@ void TcpConnection::send(const std::string &message)
     }
 }
 
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(message);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, std::move(message)));
+        }
+    }
+}
+
+void TcpConnection::flushOutput()
+{
+    loop_->assertInLoopThread();
+    /* 正在等待可写时由handleWrite()继续发送，这里直接写会与缓冲区中的数据乱序 */
+    if (channel_->isWriting() || outputBuffer_.readableBytes() == 0)
+    {
+        return;
+    }
+    ssize_t n = ::write(channel_->fd(), outputBuffer_.peek(), outputBuffer_.readableBytes());
+    if (n < 0)
+    {
+        n = 0;
+        if (errno != EWOULDBLOCK)
+            LOG_DEBUG("TcpConnection::flushOutput");
+    }
+    outputBuffer_.retrieve(n);
+    if (outputBuffer_.readableBytes() == 0)
+    {
+        outputBuffer_.retrieveAll(); // 全部发送完，读写位置回到头部，下次追加不必挪移
+        if (wriComCb_)
+        {
+            loop_->queueInLoop(std::bind(wriComCb_, shared_from_this()));
+        }
+    }
+    else
+    {
+        channel_->enableWriting();
+    }
+}
+
 void TcpConnection::shutdown()
 {
     if (state_ == kConnected)
@@ -78,8 +148,9 @@ void TcpConnection::forceClose()
     if (state_ == kConnected || state_ == kDisconnecting)
     {
         setState(kDisconnecting);
+        /* 调用者可能随即放下最后一个引用(例如TcpClient析构)，回调中持有共享指针 */
         loop_->queueInLoop(std::bind(
-            &TcpConnection::forceCloseInLoop, this));
+            &TcpConnection::forceCloseInLoop, shared_from_this()));
     }
 }
 
@@ -116,12 +187,14 @@ void TcpConnection::connEstablished()
 void TcpConnection::connDestroyed()
 {
     loop_->assertInLoopThread();
-    assert(state_ == kConnected || state_ == kDisconnecting);
+    /* 通常已由handleClose()置为kDisconnected，TcpServer析构时也会直接销毁仍然连接着的连接 */
+    assert(state_ != kConnecting);
     setState(kDisconnected);
     channel_->disableAll();
     connCb_(shared_from_this());
 
     loop_->removeChannel(channel_.get());
+    loop_->decConnections();
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
@@ -192,6 +265,8 @@ void TcpConnection::handleClose()
 {
     loop_->assertInLoopThread();
     assert(state_ == kConnected || state_ == kDisconnecting);
+    /* 立即置为断开，之后的forceClose()和send()都不再生效，关闭回调只会执行一次 */
+    setState(kDisconnected);
     channel_->disableAll();
     closeCb_(shared_from_this()); //<-TcpServer::removeConnection(对TcpConnection::connDestroyed的封装) - 析构本TcpConnection对象
 }
@@ -199,7 +274,7 @@ void TcpConnection::handleClose()
 void TcpConnection::handleError()
 {
     int err = Socket::getSocketError(channel_->fd());
-    LOG_DEBUG("TcpConnection::handleError [%s] SO_ERROR = %d %s", name_, err, strerror_tl(err));
+    LOG_DEBUG("TcpConnection::handleError [%s] SO_ERROR = %d %s", name().c_str(), err, strerror(err));
 }
 
 void TcpConnection::sendInLoop(const std::string &message)
@@ -3,6 +3,8 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <mutex>
+#include <stdint.h>
 
 #include "Callbacks.h"
 #include "InetAddress.h"
@@ -22,6 +24,13 @@ public:
                   int sockfd,
                   const InetAddress &localAddr,
                   const InetAddress &peerAddr);
+    /* 名字在第一次调用name()时才格式化为 namePrefix#id，建立连接时不必分配字符串 */
+    TcpConnection(EventLoop *loop,
+                  uint64_t id,
+                  std::shared_ptr<const std::string> namePrefix,
+                  int sockfd,
+                  const InetAddress &localAddr,
+                  const InetAddress &peerAddr);
     ~TcpConnection();
 
     void setConnectionCallback(const ConnectionCallback &cb)
@@ -46,15 +55,25 @@ public:
     }
 
     bool connected() const { return state_ == kConnected; }
-    const std::string &name() const { return name_; }
+    const std::string &name() const;
+    uint64_t id() const { return id_; } // TcpServer分配的连接id，TcpClient创建的连接为0
     const InetAddress &localAddress() { return localAddr_; }
     const InetAddress &peerAddress() { return peerAddr_; }
     EventLoop *getLoop() { return loop_; }
+    int fd() const;
 
     /* 先一次性发送完数据，如果还有剩余数据，就注册写事件，等待套接字可写 */
     void send(const void *message, size_t len);
     void send(const std::string &message);
+    void send(std::string &&message); // 跨线程时移动到IO线程，不再拷贝
     void send(Buffer *buffer);
+    /**
+     * 就地组装待发送数据，只能在IO线程中调用：
+     * -outputBuffer()返回连接的输出缓冲区，调用者把数据直接追加到其中，省去中间缓冲区和拷贝；
+     * -追加完调用flushOutput()，套接字没有在等待可写时立即尝试发送，剩余部分注册写事件。
+     */
+    Buffer *outputBuffer() { return &outputBuffer_; }
+    void flushOutput();
     /* 对套接字半关闭，关闭写方向 */
     void shutdown();
     /* 服务器主动关闭连接 */
@@ -93,7 +112,10 @@ private:
 
     StateE state_;
     EventLoop *loop_;
-    std::string name_;
+    const uint64_t id_;
+    std::shared_ptr<const std::string> namePrefix_;
+    mutable std::once_flag nameOnce_;
+    mutable std::string name_;
     std::unique_ptr<Socket> socket_; // TcpConnection持有socket_的目的是析构时自动close(sockfd)
     std::unique_ptr<Channel> channel_;
     InetAddress localAddr_; // 服务器本地的IP地址
@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <algorithm>
+#include <future>
 
 #include "TcpServer.h"
 #include "InetAddress.h"
@@ -6,26 +8,75 @@
 #include "Logger.h"
 #include "EventLoopThread.h"
 #include "TcpConnection.h"
+#include "TimerId.h"
 
-TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr)
+TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, Option option)
     : loop_(loop),
+      listenAddr_(listenAddr),
+      reusePort_(option == kReusePort && !listenAddr.isUnix()),
+      nextShardId_(0),
       started_(false),
-      name_(listenAddr.toIpPort()),
-      acceptor_(std::make_unique<Acceptor>(loop, listenAddr)),
+      name_(std::make_shared<const std::string>(listenAddr.toIpPort())),
+      acceptor_(std::make_unique<Acceptor>(loop, listenAddr, option == kReusePort)),
       threadPool_(std::make_unique<EventLoopThreadPool>(loop)),
-      nextConnId_(1)
+      acceptBatchSize_(Acceptor::kDefaultAcceptBatchSize),
+      maxConnections_(0),
+      maxLoopLagUs_(0),
+      numConnections_(0),
+      numShed_(0),
+      handoffConnections_(false),
+      draining_(false),
+      drainTimeout_(0)
 {
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-                                                  std::placeholders::_1,
-                                                  std::placeholders::_2));
+    acceptor_->setNewConnectionBatchCallback(std::bind(&TcpServer::newConnections, this,
+                                                       std::placeholders::_1));
+}
+
+TcpServer::TcpServer(EventLoop *loop, const SocketHandoff::Sockets &inherited, Option option)
+    : loop_(loop),
+      listenAddr_(Socket::getLocalAddr(inherited.listenFds.front())),
+      reusePort_(option == kReusePort && !listenAddr_.isUnix()),
+      nextShardId_(0),
+      started_(false),
+      name_(std::make_shared<const std::string>(listenAddr_.toIpPort())),
+      acceptor_(std::make_unique<Acceptor>(loop, inherited.listenFds.front())),
+      threadPool_(std::make_unique<EventLoopThreadPool>(loop)),
+      acceptBatchSize_(Acceptor::kDefaultAcceptBatchSize),
+      maxConnections_(0),
+      maxLoopLagUs_(0),
+      numConnections_(0),
+      numShed_(0),
+      inheritedListenFds_(inherited.listenFds.begin() + 1, inherited.listenFds.end()),
+      inheritedConnFds_(inherited.connFds),
+      handoffConnections_(false),
+      draining_(false),
+      drainTimeout_(0)
+{
+    acceptor_->setNewConnectionBatchCallback(std::bind(&TcpServer::newConnections, this,
+                                                       std::placeholders::_1));
 }
 
 TcpServer::~TcpServer()
 {
     started_ = false;
-    for (auto &it : connections_)
+    /* 每个连接在自己的IO线程中销毁，此时IO线程尚未退出 */
+    for (auto &it : shards_)
     {
-        it.second.reset();
+        Shard *shard = it.second.get();
+        ConnectionList conns;
+        {
+            std::lock_guard<std::mutex> lk(shard->mutex);
+            shard->connections.forEach([&conns](TcpConnectionPtr &conn)
+                                       { conns.push_back(conn); });
+            for (const TcpConnectionPtr &conn : conns)
+            {
+                shard->connections.erase(conn->id());
+            }
+        }
+        for (const TcpConnectionPtr &conn : conns)
+        {
+            conn->getLoop()->runInLoop(std::bind(&TcpConnection::connDestroyed, conn));
+        }
     }
 }
 
@@ -35,52 +86,438 @@ void TcpServer::start()
     {
         started_ = true;
         threadPool_->start();
+        acceptor_->setAcceptBatchSize(acceptBatchSize_);
+
+        std::vector<EventLoop *> allLoops = threadPool_->getAllLoops();
+        std::vector<EventLoop *> ioLoops;
+        for (EventLoop *ioLoop : allLoops)
+        {
+            addShard(ioLoop, allLoops.size() == 1);
+            if (ioLoop != loop_)
+            {
+                ioLoops.push_back(ioLoop);
+            }
+        }
+
+        /* 每个IO线程各自监听同一地址，连接由内核按四元组散列到各个监听套接字 */
+        size_t nextInherited = 0;
+        if (reusePort_)
+        {
+            for (EventLoop *ioLoop : ioLoops)
+            {
+                /* 优先使用继承来的监听套接字，其已完成连接队列中的连接不会丢失 */
+                if (nextInherited < inheritedListenFds_.size())
+                {
+                    addIoAcceptor(std::make_unique<Acceptor>(ioLoop, inheritedListenFds_[nextInherited++]));
+                }
+                else
+                {
+                    addIoAcceptor(std::make_unique<Acceptor>(ioLoop, listenAddr_, true));
+                }
+            }
+        }
+        /* 多出来的继承套接字也要继续accept，不能直接关闭，否则其队列中的连接会被重置 */
+        for (size_t i = 0; nextInherited < inheritedListenFds_.size(); ++i)
+        {
+            EventLoop *ioLoop = reusePort_ && !ioLoops.empty() ? ioLoops[i % ioLoops.size()] : loop_;
+            addIoAcceptor(std::make_unique<Acceptor>(ioLoop, inheritedListenFds_[nextInherited++]));
+        }
+        inheritedListenFds_.clear();
+
+        /* kReusePort模式下只要有IO线程，baseLoop就不再接收连接 */
+        if (!reusePort_ || ioLoops.empty())
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+        if (!inheritedConnFds_.empty())
+        {
+            loop_->runInLoop(std::bind(&TcpServer::adoptInheritedConnections, this));
+        }
     }
-    if (!acceptor_->listenning())
+}
+
+EventLoop *TcpServer::addIoLoop()
+{
+    loop_->assertInLoopThread();
+    assert(started_);
+    EventLoop *ioLoop = threadPool_->addLoop();
+    addShard(ioLoop, false);
+    if (reusePort_)
     {
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        addIoAcceptor(std::make_unique<Acceptor>(ioLoop, listenAddr_, true));
     }
+    return ioLoop;
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
+bool TcpServer::retireIoLoop(EventLoop *ioLoop)
 {
     loop_->assertInLoopThread();
-    char buf[64];
-    snprintf(buf, sizeof(buf), "#%d", nextConnId_);
-    nextConnId_++;
-    std::string name = name_ + buf;
+    assert(started_);
+    auto shardIt = shards_.find(ioLoop);
+    if (shardIt == shards_.end())
+    {
+        LOG_ERROR("TcpServer::retireIoLoop[%s] %p is not an io loop", name_->c_str(), ioLoop);
+        return false;
+    }
+    Shard *shard = shardIt->second.get();
+    /**
+     * 退休只等待本服务器的分片，loop上的其他连接(如TcpClient)会在loop退出后悬空，所以拒绝退休；
+     * 在ioLoop中比较两个计数，此时baseLoop阻塞在这里不会再为它创建连接，连接的销毁也都在ioLoop中
+     */
+    std::promise<int> done;
+    std::future<int> others = done.get_future();
+    ioLoop->runInLoop([ioLoop, shard, &done]()
+                      { done.set_value(ioLoop->connectionCount() - shard->alive.load(std::memory_order_relaxed)); });
+    int foreign = others.get();
+    if (foreign > 0)
+    {
+        LOG_ERROR("TcpServer::retireIoLoop[%s] %p refused, %d connections not owned by this server",
+                  name_->c_str(), ioLoop, foreign);
+        return false;
+    }
+    if (!threadPool_->retireLoop(ioLoop, std::bind(&TcpServer::removeShard, this, std::placeholders::_1),
+                                 [shard](EventLoop *)
+                                 { return shard->alive.load(std::memory_order_relaxed) == 0; }))
+    {
+        return false;
+    }
+    /**
+     * 关闭监听套接字使其退出SO_REUSEPORT组，内核不再把新连接散列给它；
+     * 关闭时队列中尚未accept的连接会被内核重置，所以在ioLoop中先取空队列再立即关闭，
+     * 取出的连接交给baseLoop按策略分给其余IO线程
+     */
+    for (auto it = ioAcceptors_.begin(); it != ioAcceptors_.end();)
+    {
+        if ((*it)->getLoop() == ioLoop)
+        {
+            std::shared_ptr<Acceptor> acceptor(std::move(*it));
+            ioLoop->runInLoop([this, acceptor]() mutable
+                              {
+                                  NewConnectionList conns;
+                                  acceptor->stop();
+                                  acceptor->acceptPending(&conns);
+                                  acceptor.reset();
+                                  if (!conns.empty())
+                                  {
+                                      LOG_INFO("TcpServer::retireIoLoop[%s] hand over %zu pending connections",
+                                               name_->c_str(), conns.size());
+                                      loop_->runInLoop(std::bind(&TcpServer::newConnections, this, std::move(conns)));
+                                  }
+                              });
+            it = ioAcceptors_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void TcpServer::addShard(EventLoop *ioLoop, bool single)
+{
+    auto shard = std::make_unique<Shard>();
+    shard->loop = ioLoop;
+    shard->namePrefix = single ? name_
+                               : std::make_shared<const std::string>(*name_ + "/" + std::to_string(nextShardId_));
+    ++nextShardId_;
+    std::lock_guard<std::mutex> lk(mutex_);
+    shards_[ioLoop] = std::move(shard);
+}
 
-    /* 从线程池里取出空闲的线程 */
-    EventLoop *ioLoop = threadPool_->getNextLoop();
+void TcpServer::removeShard(EventLoop *ioLoop)
+{
+    loop_->assertInLoopThread();
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = shards_.find(ioLoop);
+    assert(it != shards_.end());
+    /* 线程池只在分片中的连接全部销毁后才回调，分片中已经没有记录 */
+    shards_.erase(it);
+}
 
-    LOG_INFO("TcpServer::newConnection[%s] new connection[%s] from %s", name_.c_str(), name.c_str(), peerAddr.toIpPort().c_str());
+void TcpServer::addIoAcceptor(std::unique_ptr<Acceptor> acceptor)
+{
+    EventLoop *ioLoop = acceptor->getLoop();
+    acceptor->setAcceptBatchSize(acceptBatchSize_);
+    if (ioLoop == loop_)
+    {
+        acceptor->setNewConnectionBatchCallback(std::bind(&TcpServer::newConnections, this,
+                                                          std::placeholders::_1));
+    }
+    else
+    {
+        acceptor->setNewConnectionBatchCallback(std::bind(&TcpServer::newConnectionsInLoop, this, shardOf(ioLoop),
+                                                          std::placeholders::_1));
+    }
+    ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor.get()));
+    ioAcceptors_.push_back(std::move(acceptor));
+}
+
+void TcpServer::adoptInheritedConnections()
+{
+    loop_->assertInLoopThread();
+    NewConnectionList conns;
+    for (int sockfd : inheritedConnFds_)
+    {
+        conns.emplace_back(sockfd, InetAddress(Socket::getPeerAddr(sockfd)));
+    }
+    inheritedConnFds_.clear();
+    LOG_INFO("TcpServer::adoptInheritedConnections[%s] %zu connections", name_->c_str(), conns.size());
+    newConnections(conns);
+}
+
+void TcpServer::newConnections(const NewConnectionList &newConns)
+{
+    loop_->assertInLoopThread();
+    for (const auto &it : newConns)
+    {
+        /* 从线程池里取出空闲的线程 */
+        EventLoop *ioLoop = threadPool_->getNextLoop(it.second);
+        if (!admitConnection(ioLoop, it.first))
+        {
+            continue;
+        }
+        TcpConnectionPtr conn = createConnection(shardOf(ioLoop), it.first, it.second);
+
+        /* IO线程数量很少，线性查找即可 */
+        auto batch = std::find_if(dispatchBatches_.begin(), dispatchBatches_.end(),
+                                  [ioLoop](const std::pair<EventLoop *, ConnectionList> &b)
+                                  { return b.first == ioLoop; });
+        if (batch == dispatchBatches_.end())
+        {
+            dispatchBatches_.emplace_back(ioLoop, ConnectionList());
+            batch = dispatchBatches_.end() - 1;
+        }
+        batch->second.push_back(std::move(conn));
+    }
+
+    /* 交给子线程去建立TcpConnection，每个子线程只需唤醒一次 */
+    for (auto &batch : dispatchBatches_)
+    {
+        batch.first->runInLoop(std::bind(&TcpServer::establishConnections, std::move(batch.second)));
+    }
+    dispatchBatches_.clear();
+}
+
+void TcpServer::newConnectionsInLoop(Shard *shard, const NewConnectionList &newConns)
+{
+    shard->loop->assertInLoopThread();
+    for (const auto &it : newConns)
+    {
+        if (!admitConnection(shard->loop, it.first))
+        {
+            continue;
+        }
+        TcpConnectionPtr conn = createConnection(shard, it.first, it.second);
+        conn->connEstablished();
+    }
+}
+
+void TcpServer::establishConnections(const ConnectionList &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connEstablished();
+    }
+}
+
+void TcpServer::setAcceptRate(double connectionsPerSecond, double burst)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    acceptRate_.setRate(connectionsPerSecond, burst);
+}
+
+bool TcpServer::admitConnection(EventLoop *ioLoop, int sockfd)
+{
+    bool admitted = maxConnections_ <= 0 || numConnections_.load(std::memory_order_relaxed) < maxConnections_;
+    if (admitted && maxLoopLagUs_ > 0)
+    {
+        admitted = ioLoop->iterationLagUs() <= maxLoopLagUs_;
+    }
+    if (admitted)
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        admitted = acceptRate_.tryAcquire(Timestamp::monotonicNow());
+    }
+
+    if (!admitted)
+    {
+        numShed_.fetch_add(1, std::memory_order_relaxed);
+        Socket::close(sockfd);
+        return false;
+    }
+    /* 先计入连接数，同一批次中后面的连接才能看到 */
+    numConnections_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+TcpConnectionPtr TcpServer::createConnection(Shard *shard, int sockfd, const InetAddress &peerAddr)
+{
     InetAddress localAddr(Socket::getLocalAddr(sockfd));
+    std::lock_guard<std::mutex> lk(shard->mutex);
+    /* 先占住槽位拿到id，连接的名字等到真正需要时再格式化 */
+    ConnectionMap::Id id = shard->connections.insert(TcpConnectionPtr());
+    shard->alive.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("TcpServer::newConnection[%s] new connection[#%lu] from %s", shard->namePrefix->c_str(), id, peerAddr.toIpPort().c_str());
 
     /* 创建TcpConnection并做一些注册回调的准备工作 */
-    TcpConnectionPtr conn = std::make_shared<TcpConnection>(ioLoop, name, sockfd, localAddr, peerAddr);
-    connections_[name] = conn;
+    TcpConnectionPtr conn = std::make_shared<TcpConnection>(shard->loop, id, shard->namePrefix, sockfd, localAddr, peerAddr);
+    *shard->connections.find(id) = conn;
     conn->setConnectionCallback(connCb_);
     conn->setMessageCallback(messaCb_);
     conn->setWriteCompleteCallback(wriComCb_);
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, shard, std::placeholders::_1));
+    return conn;
+}
+
+void TcpServer::removeConnection(Shard *shard, const TcpConnectionPtr &conn)
+{
+    /* 连接关闭发生在所属的IO线程，就地删除记录，不再经过baseLoop */
+    shard->loop->assertInLoopThread();
+    LOG_INFO("TcpServer::removeConnection [%s] - connection #%lu", shard->namePrefix->c_str(), conn->id());
+    bool erased;
+    {
+        std::lock_guard<std::mutex> lk(shard->mutex);
+        erased = shard->connections.erase(conn->id());
+    }
+    assert(erased);
+    (void)erased;
+    shard->loop->queueInLoop([shard, conn]()
+                             {
+                                 conn->connDestroyed();
+                                 shard->alive.fetch_sub(1, std::memory_order_relaxed);
+                             });
+    /* 只有排空过程中连接数归零时才通知baseLoop，与handedOff()中先置draining_再检查计数相对，不能用relaxed */
+    if (numConnections_.fetch_sub(1) == 1 && draining_.load())
+    {
+        loop_->runInLoop(std::bind(&TcpServer::checkDrained, this));
+    }
+}
+
+TcpServer::Shard *TcpServer::shardOf(EventLoop *ioLoop)
+{
+    loop_->assertInLoopThread();
+    auto it = shards_.find(ioLoop);
+    assert(it != shards_.end());
+    return it->second.get();
+}
+
+TcpServer::ConnectionList TcpServer::snapshotConnections()
+{
+    ConnectionList conns;
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto &it : shards_)
+    {
+        Shard *shard = it.second.get();
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        shard->connections.forEach([&conns](TcpConnectionPtr &conn)
+                                   { conns.push_back(conn); });
+    }
+    return conns;
+}
+
+void TcpServer::forEachConnection(const ConnectionFunc &func)
+{
+    for (const TcpConnectionPtr &conn : snapshotConnections())
+    {
+        func(conn);
+    }
+}
+
+void TcpServer::forEachConnectionInLoop(const ConnectionFunc &func)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto &it : shards_)
+    {
+        Shard *shard = it.second.get();
+        shard->loop->runInLoop([shard, func]()
+                               {
+                                   ConnectionList conns;
+                                   {
+                                       std::lock_guard<std::mutex> shardLock(shard->mutex);
+                                       shard->connections.forEach([&conns](TcpConnectionPtr &conn)
+                                                                  { conns.push_back(conn); });
+                                   }
+                                   for (const TcpConnectionPtr &conn : conns)
+                                   {
+                                       func(conn);
+                                   } });
+    }
+}
 
-    /* 交给子线程去建立TcpConnection */
-    ioLoop->runInLoop(std::bind(&TcpConnection::connEstablished, conn));
+void TcpServer::enableHandoff(const std::string &path, bool passConnections)
+{
+    loop_->assertInLoopThread();
+    handoffConnections_ = passConnections;
+    handoff_ = std::make_unique<SocketHandoff>(loop_, path);
+    handoff_->setCollectCallback(std::bind(&TcpServer::collectSockets, this, std::placeholders::_1));
+    handoff_->setHandedOffCallback(std::bind(&TcpServer::handedOff, this));
+    handoff_->listen();
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+void TcpServer::collectSockets(SocketHandoff::Sockets *sockets)
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    loop_->assertInLoopThread();
+    sockets->listenFds.push_back(acceptor_->fd());
+    for (const auto &acceptor : ioAcceptors_)
+    {
+        sockets->listenFds.push_back(acceptor->fd());
+    }
+    if (handoffConnections_)
+    {
+        for (const TcpConnectionPtr &conn : snapshotConnections())
+        {
+            sockets->connFds.push_back(conn->fd());
+        }
+    }
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+void TcpServer::handedOff()
 {
     loop_->assertInLoopThread();
-    LOG_INFO("TcpServer::removeConnection [%s] - connection %s", name_.c_str(), conn->name().c_str());
-    ssize_t n = connections_.erase(conn->name());
-    assert(n == 1);
-    (void)n;
-    EventLoop *ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connDestroyed, conn));
+    /* 新进程已经持有同一批监听套接字，这里只停止accept，套接字本身随Acceptor析构关闭 */
+    acceptor_->stop();
+    for (const auto &acceptor : ioAcceptors_)
+    {
+        acceptor->getLoop()->runInLoop(std::bind(&Acceptor::stop, acceptor.get()));
+    }
+
+    draining_ = true;
+    /* 已移交的连接直接丢弃本进程的副本，close()不会向对端发送FIN */
+    closeAllConnections(handoffConnections_);
+    if (drainTimeout_ > 0)
+    {
+        loop_->runAfter(drainTimeout_, std::bind(&TcpServer::closeAllConnections, this, true));
+    }
+    checkDrained();
+}
+
+void TcpServer::closeAllConnections(bool force)
+{
+    ConnectionList conns = snapshotConnections();
+    LOG_INFO("TcpServer::closeAllConnections[%s] %s %zu connections", name_->c_str(),
+             force ? "closing" : "shutting down", conns.size());
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        if (force)
+        {
+            conn->forceClose();
+        }
+        else
+        {
+            conn->shutdown();
+        }
+    }
+}
+
+void TcpServer::checkDrained()
+{
+    loop_->assertInLoopThread();
+    if (draining_.load() && numConnections_.load() == 0 && drainedCb_)
+    {
+        LOG_INFO("TcpServer::checkDrained[%s] all connections closed", name_->c_str());
+        std::function<void()> cb;
+        cb.swap(drainedCb_); // 只通知一次
+        cb();
+    }
 }
\ No newline at end of file
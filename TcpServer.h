@@ -2,23 +2,37 @@
 
 #include <functional>
 #include <memory>
-#include <unordered_map>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 #include "EventLoopThreadPool.h"
 #include "Callbacks.h"
+#include "InetAddress.h"
+#include "SlotMap.h"
+#include "SocketHandoff.h"
+#include "TokenBucket.h"
 #include "noncopyable.h"
 
 class Acceptor;
 class EventLoop;
-class InetAddress;
 class TcpConnection;
 
 /* TcpServer负责处理连接请求，创建和关闭TcpConnection */
 class TcpServer : noncopyable
 {
 public:
-    TcpServer(EventLoop *loop, const InetAddress &listenAddr);
+    enum Option
+    {
+        kNoReusePort, // 只由baseLoop上的Acceptor接收连接，再分发给IO线程
+        kReusePort,   // 每个IO线程各自持有SO_REUSEPORT监听套接字，就地接收并建立连接，Unix域地址不支持，按kNoReusePort处理
+    };
+
+    TcpServer(EventLoop *loop, const InetAddress &listenAddr, Option option = kNoReusePort);
+    /* 接管旧进程通过SocketHandoff::receive()移交的套接字，listenFds[0]作为主监听套接字 */
+    TcpServer(EventLoop *loop, const SocketHandoff::Sockets &inherited, Option option = kNoReusePort);
     ~TcpServer(); // 析构时移除剩下的TcpConnection记录
 
     void setConnectionCallback(const ConnectionCallback &cb)
@@ -34,25 +48,134 @@ public:
         wriComCb_ = std::move(cb);
     }
     void setThreadNum(int threadNum) { threadPool_->setThreadNum(threadNum); }
+    EventLoopThreadPool *threadPool() { return threadPool_.get(); } // start()之后可与TcpClientPool共用IO线程
+    /* 为新连接选择IO线程的策略，kReusePort模式下连接由内核分配，策略不起作用 */
+    void setLoopStrategy(EventLoopThreadPool::Strategy strategy) { threadPool_->setStrategy(strategy); }
+    void setLoopSelector(const EventLoopThreadPool::LoopSelector &selector) { threadPool_->setLoopSelector(selector); }
+    /* 每次可读事件最多accept的连接数，需要在start()之前设置 */
+    void setAcceptBatchSize(int n) { acceptBatchSize_ = n; }
+
+    /**
+     * 准入控制，被拒绝的连接accept后立即关闭，避免在内核队列中积压而拖慢所有客户：
+     * -setMaxConnections()限制同时存在的连接数，0表示不限制；
+     * -setAcceptRate()用令牌桶限制每秒新建连接数，rate<=0表示不限制；
+     * -setMaxLoopLag()在目标IO线程的循环延迟超过阈值时拒绝新连接，直到其恢复，0表示不检查。
+     */
+    void setMaxConnections(int maxConnections) { maxConnections_ = maxConnections; }
+    void setAcceptRate(double connectionsPerSecond, double burst);
+    void setMaxLoopLag(double seconds) { maxLoopLagUs_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond); }
+    int64_t numShedConnections() const { return numShed_.load(std::memory_order_relaxed); } // 累计被拒绝的连接数
+
+    /**
+     * 平滑重启，必须在loop线程中调用：
+     * -在Unix域套接字path上等待新进程接管，接管后停止accept，已有连接半关闭写方向后等待对端关闭；
+     * -passConnections为true时存活连接也一并移交，旧进程直接丢弃自己的副本，
+     *  只适用于请求-应答协议且连接处于消息边界的场景，否则新旧进程会读到半条消息；
+     * -setDrainTimeout()之后仍未关闭的连接被强制关闭，0表示一直等待；
+     * -所有连接关闭后执行drained回调，通常在其中退出loop。
+     */
+    void enableHandoff(const std::string &path, bool passConnections = false);
+    void setDrainTimeout(double seconds) { drainTimeout_ = seconds; }
+    void setDrainedCallback(const std::function<void()> &cb) { drainedCb_ = std::move(cb); }
     void start(); // 服务器初始化连接监听连接请求的到来
 
+    /**
+     * 运行时增减IO线程，只能在loop线程中、start()之后调用：
+     * -addIoLoop()新增一个IO线程及其连接分片，kReusePort模式下同时为其添加监听套接字；
+     * -retireIoLoop()让ioLoop不再接收新连接(kReusePort模式下先取出其监听队列中已完成握手的连接交给其他IO线程，再关闭监听套接字)，
+     *  已有连接照常服务，分片中的连接全部销毁后移除分片并退出该IO线程；
+     *  ioLoop上还有不属于本服务器的连接(如TcpClient)时返回false，退休之后也不应再在ioLoop上创建这类连接。
+     */
+    EventLoop *addIoLoop();
+    bool retireIoLoop(EventLoop *ioLoop);
+
+    /**
+     * 遍历所有连接，可以在任意线程调用：
+     * -forEachConnection()在调用者线程中对各分片的快照执行func；
+     * -forEachConnectionInLoop()在每个连接所属的IO线程中执行func，适合广播，send()不必再跨线程拷贝。
+     */
+    using ConnectionFunc = std::function<void(const TcpConnectionPtr &)>;
+    void forEachConnection(const ConnectionFunc &func);
+    void forEachConnectionInLoop(const ConnectionFunc &func);
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+
 private:
-    /* 创建TcpConnection，设置回调，添加connection记录，开启对socket的监听*/
-    void newConnection(int sockfd, const InetAddress &peerAddr);
-    /* 移除对connection的记录，延后移除Channel(延后是因为有可能还有剩下的IO事务未处理) */
-    void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    using NewConnectionList = std::vector<std::pair<int, InetAddress>>;
+    using ConnectionList = std::vector<TcpConnectionPtr>;
+    /* 以连接id为键，查找和删除都是O(1)且无需对名字做哈希 */
+    using ConnectionMap = SlotMap<TcpConnectionPtr>;
+
+    /**
+     * 每个IO线程一个连接分片，连接关闭时在自己的IO线程中就地删除记录，不再绕道baseLoop：
+     * -只有所属IO线程和建立连接的线程会写入，mutex几乎没有竞争，仅供跨线程遍历时加锁；
+     * -连接id只在分片内唯一，有多个分片时名字前缀附带分片序号以保证连接名唯一。
+     */
+    struct Shard
+    {
+        Shard() : loop(nullptr), alive(0) {}
+
+        EventLoop *loop;
+        std::shared_ptr<const std::string> namePrefix;
+        std::mutex mutex;
+        ConnectionMap connections;
+        /* 尚未执行完connDestroyed()的连接数，比connections多包含正在销毁的连接，IO线程退休时据此判断分片已空 */
+        std::atomic<int> alive;
+    };
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    /* 为一批新连接创建TcpConnection并分给IO线程，每个IO线程每批只投递一个回调 */
+    void newConnections(const NewConnectionList &newConns);
+    /* kReusePort模式下由IO线程自己的Acceptor回调，不再跨线程分发 */
+    void newConnectionsInLoop(Shard *shard, const NewConnectionList &newConns);
+    /* 创建TcpConnection，设置回调，在分片中添加connection记录 */
+    TcpConnectionPtr createConnection(Shard *shard, int sockfd, const InetAddress &peerAddr);
+    /* 在IO线程中开启对socket的监听 */
+    static void establishConnections(const ConnectionList &conns);
+    /* 准入检查，不通过则关闭sockfd并返回false */
+    bool admitConnection(EventLoop *ioLoop, int sockfd);
+    /* 在连接所属的IO线程中移除分片里的记录，延后移除Channel(延后是因为有可能还有剩下的IO事务未处理) */
+    void removeConnection(Shard *shard, const TcpConnectionPtr &conn);
+    Shard *shardOf(EventLoop *ioLoop); // 只在baseLoop中调用
+    void addShard(EventLoop *ioLoop, bool single);
+    void removeShard(EventLoop *ioLoop); // IO线程退休时由线程池在baseLoop中回调
+    ConnectionList snapshotConnections();
+    /* kReusePort模式下为IO线程添加Acceptor并在其线程中开始监听 */
+    void addIoAcceptor(std::unique_ptr<Acceptor> acceptor);
+    /* 把继承来的存活连接当作新连接建立 */
+    void adoptInheritedConnections();
+    /* SocketHandoff的回调 */
+    void collectSockets(SocketHandoff::Sockets *sockets);
+    void handedOff();
+    void closeAllConnections(bool force);
+    void checkDrained();
 
     EventLoop *loop_; // TcpServer持有loop_，但不决定loop的生死
+    const InetAddress listenAddr_;
+    const bool reusePort_;
+    /* kReusePort模式下每个IO线程的Acceptor，声明在threadPool_之前，保证在IO线程退出后才析构 */
+    std::vector<std::unique_ptr<Acceptor>> ioAcceptors_;
+    /* 记录TcpConnection，以便检索来管理TcpConnection生命期，同样要在IO线程退出后才析构 */
+    std::unordered_map<EventLoop *, std::unique_ptr<Shard>> shards_;
+    int nextShardId_; // 分片序号只增不减，IO线程退休后新分片的连接名也不会重复
     std::unique_ptr<EventLoopThreadPool> threadPool_;
-    const std::string name_;
+    const std::shared_ptr<const std::string> name_; // 与所有连接共享，作为连接名字的前缀
     bool started_;
-    std::unique_ptr<Acceptor> acceptor_; // 只有TcpServer才能持有acceptor
+    std::unique_ptr<Acceptor> acceptor_; // 只有TcpServer才能持有acceptor，kReusePort模式下仅在没有IO线程时使用
     ConnectionCallback connCb_;
     MessageCallback messaCb_;
     WriteCompleteCallback wriComCb_;
-    int nextConnId_;
-    ConnectionMap connections_; // 记录TcpConnection，以便检索来管理TcpConnection生命期
+    int acceptBatchSize_;
+    std::vector<std::pair<EventLoop *, ConnectionList>> dispatchBatches_; // newConnections()按IO线程分组的缓存
+    int maxConnections_;
+    int64_t maxLoopLagUs_;
+    TokenBucket acceptRate_; // 由mutex_保护
+    std::atomic<int> numConnections_;
+    std::atomic<int64_t> numShed_;
+    std::mutex mutex_; // 保护acceptRate_和shards_，shards_只在baseLoop中修改，baseLoop自己读取时无需加锁
+    std::vector<int> inheritedListenFds_; // 继承来的其余监听套接字，start()时分给IO线程
+    std::vector<int> inheritedConnFds_;   // 继承来的存活连接，start()时建立
+    std::unique_ptr<SocketHandoff> handoff_;
+    bool handoffConnections_;
+    std::atomic<bool> draining_; // 已移交套接字，等待剩下的连接关闭，IO线程关闭连接时读取
+    double drainTimeout_;
+    std::function<void()> drainedCb_;
 };
\ No newline at end of file
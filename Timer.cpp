@@ -6,10 +6,24 @@ void Timer::restart(Timestamp now)
 {
     if (repeat_)
     {
-        expiration_ = addTime(now, interval_);
+        expiration_ = coalesce(addTime(now, interval_), slackUs_);
     }
     else
     {
         expiration_ = Timestamp::invalid();
     }
 }
+
+Timestamp Timer::coalesce(Timestamp when, int64_t slackUs)
+{
+    int64_t from = when.microSecondsSinceEpoch();
+    if (slackUs <= 0 || from <= 0)
+    {
+        return when;
+    }
+    /* from与to最高的不同位为k，to清零低k位后仍不小于from，且是区间内末尾0最多的数 */
+    uint64_t lo = static_cast<uint64_t>(from);
+    uint64_t hi = lo + static_cast<uint64_t>(slackUs);
+    int k = 63 - __builtin_clzll(lo ^ hi);
+    return Timestamp(static_cast<int64_t>(hi & ~((1ULL << k) - 1)));
+}
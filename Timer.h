@@ -8,20 +8,47 @@
 /**
  * -Timer是对到期时间和回调函数的封装；
  * -提供定期执行的功能；
+ * -由TimerPool复用，每次取出时用init()重新赋值并分配新的序列号；
+ * -可以带一个容差slack，实际到期时间取[when, when+slack]中最"整"的时刻(二进制末尾0最多)，
+ *  窗口重叠的定时器大多落在同一时刻，由同一次timerfd唤醒一起触发。
  */
 class Timer : noncopyable
 {
 public:
-    Timer(Timestamp when, const TimerCallback &cb, double interval)
+    Timer()
+        : interval_(0.0),
+          slackUs_(0),
+          repeat_(false),
+          sequence_(-1),
+          bucket_(-1),
+          index_(0)
+    {
+    }
+    Timer(Timestamp when, const TimerCallback &cb, double interval, double slack = 0.0)
         : callback_(std::move(cb)),
-          expiration_(when),
+          expiration_(coalesce(when, toSlackUs(slack))),
           interval_(interval),
+          slackUs_(toSlackUs(slack)),
           repeat_(interval_ > 0.0),
-          sequence_(Timer::seq_increAndGet())
+          sequence_(Timer::seq_increAndGet()),
+          bucket_(-1),
+          index_(0)
     {
     }
     ~Timer() {}
 
+    void init(Timestamp when, const TimerCallback &cb, double interval, double slack = 0.0)
+    {
+        callback_ = cb;
+        interval_ = interval;
+        slackUs_ = toSlackUs(slack);
+        expiration_ = coalesce(when, slackUs_);
+        repeat_ = interval > 0.0;
+        sequence_.store(Timer::seq_increAndGet(), std::memory_order_relaxed);
+    }
+    /* 放回对象池前释放回调持有的资源 */
+    void clear() { callback_ = TimerCallback(); }
+
     void run() const
     {
         callback_();
@@ -31,16 +58,37 @@ public:
 
     Timestamp expiration() const { return expiration_; }
     bool repeat() const { return repeat_; }
-    int64_t sequence() const { return sequence_; }
+    int64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
+
+    /* 由TimerBackend记录Timer在其容器中的位置，取消时免去查找；只在loop线程中读写 */
+    int bucket() const { return bucket_; }
+    size_t index() const { return index_; }
+    void setPosition(int bucket, size_t index)
+    {
+        bucket_ = bucket;
+        index_ = index;
+    }
+
+    /* 在[when, when+slackUs]中取二进制末尾0最多的时刻，slackUs不大于0时原样返回 */
+    static Timestamp coalesce(Timestamp when, int64_t slackUs);
 
     // 线程安全，生成序列号
     static int64_t seq_increAndGet() { return seq_.fetch_add(1); }
 
 private:
+    static int64_t toSlackUs(double slack)
+    {
+        return slack > 0.0 ? static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond) : 0;
+    }
+
     TimerCallback callback_;
-    Timestamp expiration_;
-    const double interval_;
-    const bool repeat_;
-    int64_t sequence_;
+    Timestamp expiration_; // 单调时钟
+    double interval_;
+    int64_t slackUs_; // 允许推迟的微秒数
+    bool repeat_;
+    /* 对象池中的Timer可能被其他线程的addTimer取出并改写，取消时loop线程会并发读取 */
+    std::atomic<int64_t> sequence_;
+    int bucket_;   // 不在后端中时为-1
+    size_t index_;
     static std::atomic<int64_t> seq_;
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+class Timer;
+
+/**
+ * TimerQueue保存定时器的容器，与Poller一样只保留统一的接口：
+ * -TimerSet：按到期时间排序的红黑树，精确到微秒，增删O(log n)，是默认的后端；
+ * -TimerHeap：存放在vector中的4叉最小堆，精确到微秒，增删O(log n)，节点连续存放，缓存友好；
+ * -TimingWheel：分层时间轮，按1ms的刻度分桶，增删O(1)，适合大量频繁重置的超时(如空闲连接、请求超时)。
+ * 默认后端由环境变量TIMER_BACKEND(set|heap|wheel)决定，也可以用EventLoop::setTimerBackend()为单个loop指定。
+ * 后端只管理Timer的存放，不负责创建和释放，所有接口都只在loop线程中调用；
+ * Timer在后端中时bucket()不小于0，由后端通过setPosition()维护
+ */
+class TimerBackend : noncopyable
+{
+public:
+    enum Type
+    {
+        kSet,
+        kHeap,
+        kWheel,
+    };
+
+    virtual ~TimerBackend() = default;
+
+    /* 加入定时器，返回下一次唤醒时间是否因此提前(需要重新设置timerfd) */
+    virtual bool insert(Timer *timer) = 0;
+    /* 移出仍在后端中的定时器(由调用者确认)，不释放 */
+    virtual void erase(Timer *timer) = 0;
+    /* 移出所有在now之前到期的定时器，按到期时间的顺序追加到expired */
+    virtual void popExpired(Timestamp now, std::vector<Timer *> *expired) = 0;
+    /* 下一次需要处理的时刻，没有定时器时返回Timestamp::invalid()，可以早于最早的到期时间 */
+    virtual Timestamp nextWakeup() = 0;
+    virtual size_t size() const = 0;
+    /* 移出全部定时器，用于切换后端和析构 */
+    virtual void takeAll(std::vector<Timer *> *timers) = 0;
+
+    virtual const char *name() const = 0;
+
+    static TimerBackend *newBackend(Type type);
+    static TimerBackend *newDefaultBackend();
+};
@@ -0,0 +1,126 @@
+#include <assert.h>
+
+#include "TimerHeap.h"
+#include "Timer.h"
+
+bool TimerHeap::earlier(const Node &lhs, const Node &rhs)
+{
+    if (lhs.when != rhs.when)
+    {
+        return lhs.when < rhs.when;
+    }
+    return lhs.timer->sequence() < rhs.timer->sequence();
+}
+
+bool TimerHeap::insert(Timer *timer)
+{
+    heap_.push_back(Node{timer->expiration().microSecondsSinceEpoch(), timer});
+    siftUp(heap_.size() - 1);
+    return heap_.front().timer == timer;
+}
+
+void TimerHeap::erase(Timer *timer)
+{
+    assert(timer->bucket() == 0 && heap_[timer->index()].timer == timer);
+    removeAt(timer->index());
+    timer->setPosition(-1, 0);
+}
+
+void TimerHeap::popExpired(Timestamp now, std::vector<Timer *> *expired)
+{
+    const int64_t nowUs = now.microSecondsSinceEpoch();
+    while (!heap_.empty() && heap_.front().when <= nowUs)
+    {
+        Timer *timer = heap_.front().timer;
+        removeAt(0);
+        timer->setPosition(-1, 0);
+        expired->push_back(timer);
+    }
+}
+
+Timestamp TimerHeap::nextWakeup()
+{
+    return heap_.empty() ? Timestamp::invalid() : Timestamp(heap_.front().when);
+}
+
+void TimerHeap::takeAll(std::vector<Timer *> *timers)
+{
+    for (const Node &node : heap_)
+    {
+        node.timer->setPosition(-1, 0);
+        timers->push_back(node.timer);
+    }
+    heap_.clear();
+}
+
+void TimerHeap::removeAt(size_t index)
+{
+    Node last = heap_.back();
+    heap_.pop_back();
+    if (index == heap_.size())
+    {
+        return;
+    }
+    setAt(index, last);
+    if (index > 0 && earlier(last, heap_[(index - 1) / kArity]))
+    {
+        siftUp(index);
+    }
+    else
+    {
+        siftDown(index);
+    }
+}
+
+/* 调整时先拿出节点，沿路径逐个移动父(子)节点，最后写入一次，省去反复交换 */
+void TimerHeap::siftUp(size_t index)
+{
+    Node node = heap_[index];
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / kArity;
+        if (!earlier(node, heap_[parent]))
+        {
+            break;
+        }
+        setAt(index, heap_[parent]);
+        index = parent;
+    }
+    setAt(index, node);
+}
+
+void TimerHeap::siftDown(size_t index)
+{
+    const size_t n = heap_.size();
+    Node node = heap_[index];
+    while (true)
+    {
+        size_t first = index * kArity + 1;
+        if (first >= n)
+        {
+            break;
+        }
+        size_t last = first + kArity < n ? first + kArity : n;
+        size_t child = first;
+        for (size_t i = first + 1; i < last; ++i)
+        {
+            if (earlier(heap_[i], heap_[child]))
+            {
+                child = i;
+            }
+        }
+        if (!earlier(heap_[child], node))
+        {
+            break;
+        }
+        setAt(index, heap_[child]);
+        index = child;
+    }
+    setAt(index, node);
+}
+
+void TimerHeap::setAt(size_t index, const Node &node)
+{
+    heap_[index] = node;
+    node.timer->setPosition(0, index);
+}
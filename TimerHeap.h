@@ -0,0 +1,45 @@
+#pragma once
+
+#include "TimerBackend.h"
+
+/**
+ * 4叉最小堆，按(到期时间,序列号)排序，连续存放在vector中：
+ * -节点冗余保存到期时间，比较时不必访问Timer，4个兄弟节点共64字节，连续存放；
+ * -4叉比2叉的树高减半，上浮时少一半的缓存未命中；
+ * -Timer记录自己在堆中的下标(setPosition(0, index))，取消时直接从该位置删除，O(log n)；
+ * -到期时从堆顶依次弹出，顺序与TimerSet一致。
+ */
+class TimerHeap : public TimerBackend
+{
+public:
+    TimerHeap() = default;
+    ~TimerHeap() override = default;
+
+    bool insert(Timer *timer) override;
+    void erase(Timer *timer) override;
+    void popExpired(Timestamp now, std::vector<Timer *> *expired) override;
+    Timestamp nextWakeup() override;
+    size_t size() const override { return heap_.size(); }
+    void takeAll(std::vector<Timer *> *timers) override;
+    const char *name() const override { return "heap"; }
+
+private:
+    static const size_t kArity = 4;
+
+    struct Node
+    {
+        int64_t when; // 即timer->expiration()
+        Timer *timer;
+    };
+
+    /* 到期时间相同时按序列号，先加入的先触发 */
+    static bool earlier(const Node &lhs, const Node &rhs);
+
+    /* 移除index处的节点，用堆尾补位后重新调整 */
+    void removeAt(size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void setAt(size_t index, const Node &node);
+
+    std::vector<Node> heap_;
+};
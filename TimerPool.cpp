@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include "TimerPool.h"
+#include "Timer.h"
+
+const size_t TimerPool::kChunkSize;
+const size_t TimerPool::kMaxLocal;
+
+TimerPool::~TimerPool() = default;
+
+Timer *TimerPool::acquire(bool inLoopThread)
+{
+    Timer *timer;
+    if (inLoopThread)
+    {
+        if (local_.empty())
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shared_.empty())
+            {
+                allocateChunk(&local_);
+            }
+            else
+            {
+                size_t n = std::min(shared_.size(), kChunkSize);
+                local_.insert(local_.end(), shared_.end() - n, shared_.end());
+                shared_.resize(shared_.size() - n);
+            }
+        }
+        timer = local_.back();
+        local_.pop_back();
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (shared_.empty())
+        {
+            allocateChunk(&shared_);
+        }
+        timer = shared_.back();
+        shared_.pop_back();
+    }
+    return timer;
+}
+
+void TimerPool::release(Timer *timer)
+{
+    timer->clear();
+    local_.push_back(timer);
+    if (local_.size() > kMaxLocal)
+    {
+        /* 跨线程添加的定时器到期后都回到本地链表，转一半回去，避免其他线程一直分配新块 */
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t n = local_.size() / 2;
+        shared_.insert(shared_.end(), local_.end() - n, local_.end());
+        local_.resize(local_.size() - n);
+    }
+}
+
+void TimerPool::allocateChunk(std::vector<Timer *> *list)
+{
+    chunks_.emplace_back(new Timer[kChunkSize]);
+    Timer *chunk = chunks_.back().get();
+    for (size_t i = 0; i < kChunkSize; ++i)
+    {
+        list->push_back(&chunk[i]);
+    }
+}
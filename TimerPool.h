@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "noncopyable.h"
+
+class Timer;
+
+/**
+ * 每个TimerQueue独占的Timer对象池：
+ * -Timer按块分配，用完后只清空回调放回空闲链表，直到TimerQueue析构才释放内存，
+ *  所以TimerId中的指针总可以解引用，取消时比较序列号就能判断它是否仍然有效；
+ * -loop线程存取本地链表，不加锁；其他线程的addTimer从共享链表取，需要加锁；
+ * -本地链表过长时把一半转给共享链表，两边都取空时才分配新块。
+ */
+class TimerPool : noncopyable
+{
+public:
+    TimerPool() = default;
+    ~TimerPool();
+
+    /* 取出一个Timer，由调用者init()；inLoopThread表示调用者是否为所属loop线程 */
+    Timer *acquire(bool inLoopThread);
+    /* 放回Timer，只在loop线程中调用 */
+    void release(Timer *timer);
+
+private:
+    static const size_t kChunkSize = 64;
+    static const size_t kMaxLocal = 1024;
+
+    /* 分配一块Timer加入list，调用者持有mutex_ */
+    void allocateChunk(std::vector<Timer *> *list);
+
+    std::vector<Timer *> local_; // 只在loop线程中访问
+    std::mutex mutex_;
+    std::vector<Timer *> shared_;
+    std::vector<std::unique_ptr<Timer[]>> chunks_;
+};
@@ -33,16 +33,10 @@ void readTimerfd(int timerFd, Timestamp now)
     }
 }
 
-/* 将到期时间Timestamp 转化成 timespec */
-struct timespec howMuchTimeFromNow(Timestamp when)
+/* 将单调时钟的到期时间转化成timespec */
+struct timespec toTimespec(Timestamp when)
 {
-    /* 假设when没到期 */
-    int64_t microSeconds = when.microSecondsSinceEpoch() -
-                           Timestamp::now().microSecondsSinceEpoch();
-    if (microSeconds < 100)
-    {
-        microSeconds = 100;
-    }
+    int64_t microSeconds = when.microSecondsSinceEpoch();
     struct timespec ts;
     ts.tv_sec = static_cast<time_t>(
         microSeconds / Timestamp::kMicroSecondsPerSecond);
@@ -51,15 +45,16 @@ struct timespec howMuchTimeFromNow(Timestamp when)
     return ts;
 }
 
-/* 修改timerfd到期时间 */
+/*
+ * 修改timerfd到期时间，用绝对时间(TFD_TIMER_ABSTIME)，与Timer同为CLOCK_MONOTONIC，
+ * 不必再取一次当前时间换算相对值，已经过去的时间会立即触发
+ */
 void resetTimerfd(int timerFd, Timestamp when)
 {
     struct itimerspec newValue;
-    struct itimerspec oldValue;
     memset(&newValue, 0, sizeof(newValue));
-    memset(&oldValue, 0, sizeof(oldValue));
-    newValue.it_value = howMuchTimeFromNow(when);
-    int ret = ::timerfd_settime(timerFd, 0, &newValue, &oldValue);
+    newValue.it_value = toTimespec(when);
+    int ret = ::timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &newValue, NULL);
     if (ret)
     {
         LOG_INFO("timerfd_settime()");
@@ -71,8 +66,9 @@ TimerQueue::TimerQueue(EventLoop *loop)
       timerfd_(createTimerfd()),
       timerChannel_(loop, timerfd_),
       callingExpiredTimers_(false),
-      timers_(),
-      activeTimers_(),
+      armedAt_(),
+      pool_(),
+      backend_(TimerBackend::newDefaultBackend()),
       cancelingTimers_()
 {
     timerChannel_.setReadCallback(
@@ -83,27 +79,28 @@ TimerQueue::TimerQueue(EventLoop *loop)
 TimerQueue::~TimerQueue()
 {
     ::close(timerfd_);
-    for (auto &it : timers_)
-    {
-        delete it.second; // 这里delete掉指针后不用置零，因为后续如果有有程序调用该指针时，还能清楚错误位置
-    }
+    /* 剩余的定时器随pool_一起释放 */
 }
 
-TimerId TimerQueue::addTimer(Timestamp when, const TimerCallback &cb, double interval)
+TimerId TimerQueue::addTimer(Timestamp when, const TimerCallback &cb, double interval, double slack)
 {
-    Timer *timer = new Timer(when, cb, interval);
+    /* 从本loop的对象池取，其他线程调用时也不必new */
+    Timer *timer = pool_.acquire(loop_->isInLoopThread());
+    timer->init(when, cb, interval, slack);
+    /* 交给loop之后Timer可能已经触发并回到对象池被重新init()，序列号必须在此之前读取 */
+    int64_t seq = timer->sequence();
     loop_->runInLoop(
         std::bind(&TimerQueue::addTimerInLoop, this, timer));
-    return TimerId(timer, timer->sequence());
+    return TimerId(timer, seq);
 }
 
 void TimerQueue::addTimerInLoop(Timer *timer)
 {
     loop_->assertInLoopThread();
-    bool earliestChanged = insert(timer);
+    bool earliestChanged = backend_->insert(timer);
     if (earliestChanged)
     {
-        resetTimerfd(timerfd_, timer->expiration());
+        armTimerfd(backend_->nextWakeup());
     }
 }
 
@@ -116,116 +113,91 @@ void TimerQueue::cancel(TimerId timerId)
 void TimerQueue::cancelInLoop(TimerId timerId)
 {
     loop_->assertInLoopThread();
-    ActiveTimer timer(timerId.timer_, timerId.sequence_);
-    ActiveTimerSet::iterator it = activeTimers_.find(timer);
-    if (it != activeTimers_.end())
+    Timer *timer = timerId.timer_;
+    /* Timer的内存一直归对象池所有，可以直接解引用；序列号不同说明已经被回收复用 */
+    if (timer != nullptr && timer->sequence() == timerId.sequence_ && timer->bucket() >= 0)
     {
-        Entry removing(it->first->expiration(), it->first);
-        size_t n = timers_.erase(removing);
-
-        assert(n == 1);
-        (void)n;
-        delete it->first;
-        activeTimers_.erase(it);
+        backend_->erase(timer);
+        pool_.release(timer);
     }
     else if (callingExpiredTimers_)
     {
-        cancelingTimers_.insert(timer);
+        cancelingTimers_.insert(ActiveTimer(timerId.timer_, timerId.sequence_));
+    }
+}
+
+void TimerQueue::setBackend(TimerBackend::Type type)
+{
+    loop_->assertInLoopThread();
+    std::unique_ptr<TimerBackend> backend(TimerBackend::newBackend(type));
+    std::vector<Timer *> timers;
+    backend_->takeAll(&timers);
+    for (Timer *timer : timers)
+    {
+        backend->insert(timer);
     }
-    assert(timers_.size() == activeTimers_.size());
+    backend_.swap(backend);
+    LOG_DEBUG("TimerQueue::setBackend %s, %zu timers migrated", backend_->name(), timers.size());
+    rearm();
 }
 
 void TimerQueue::handleRead()
 {
     loop_->assertInLoopThread();
-    Timestamp now(Timestamp::now());
+    /* 本轮poll返回后取的时间，不晚于timerfd触发时刻 */
+    Timestamp now(loop_->now());
     readTimerfd(timerfd_, now);
+    armedAt_ = Timestamp::invalid();
 
-    /* timerfd一响应就从回调函数队列调取到期的回调函数 */
-    std::vector<Entry> expired = getExpired(now);
+    /* timerfd一响应就从后端取出到期的定时器，回调中新加的定时器进入后端，不影响这一批 */
+    backend_->popExpired(now, &expired_);
 
     cancelingTimers_.clear();
     callingExpiredTimers_ = true;
-    for (const Entry &it : expired)
+    for (Timer *timer : expired_)
     {
-        it.second->run();
+        timer->run();
     }
     callingExpiredTimers_ = false;
 
-    reset(std::move(expired), now);
+    reset(expired_, now);
+    expired_.clear();
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+void TimerQueue::reset(std::vector<Timer *> &expired, Timestamp now)
 {
-    std::vector<Entry> expired;
-
-    /* 设定一个当前时间的哨兵值，得到第一个不早于它的Timer迭代器 */
-    TimerQueue::Entry sentry = std::make_pair(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-    TimerList::iterator last = timers_.lower_bound(sentry);
-    assert(last == timers_.end() || now < last->first);
-    auto start = timers_.begin();
-
-    /* 将到期的Timer转移到vector数组中并返回,用右值语义效率更好 */
-    // std::copy(start, last, std::back_inserter(expired));
-    std::move(std::make_move_iterator(start), std::make_move_iterator(last),
-              std::back_inserter(expired));
-    timers_.erase(start, last);
-
-    std::for_each(expired.begin(), expired.end(), [&](Entry &it)
-                  {
-        ActiveTimer timer(it.second,it.second->sequence());
-        size_t n=activeTimers_.erase(timer);
-        assert(n==1);(void)n; });
-
-    assert(timers_.size() == activeTimers_.size());
-    return expired;
-}
-
-void TimerQueue::reset(std::vector<Entry> &&expired, Timestamp now)
-{
-    Timestamp nextExpired;
-    for (Entry &it : expired)
+    for (Timer *timer : expired)
     {
-        ActiveTimer timer(it.second, it.second->sequence());
-        if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+        ActiveTimer active(timer, timer->sequence());
+        if (timer->repeat() && cancelingTimers_.find(active) == cancelingTimers_.end())
         {
-            it.second->restart(now);
-            insert(it.second);
+            timer->restart(now);
+            backend_->insert(timer);
         }
         else
         {
-            delete it.second;
+            pool_.release(timer);
         }
     }
+    rearm();
+}
 
-    /* 比较最先到期的原定时器，如果新定时器先到期就重置timerfd_ */
-    if (!timers_.empty())
-    {
-        nextExpired = timers_.begin()->second->expiration();
-    }
+void TimerQueue::rearm()
+{
+    /* 没有定时器时不必撤销timerfd，多一次空的触发无妨 */
+    Timestamp nextExpired = backend_->nextWakeup();
     if (nextExpired.isValid())
     {
-        resetTimerfd(timerfd_, nextExpired);
+        armTimerfd(nextExpired);
     }
 }
 
-bool TimerQueue::insert(Timer *timer)
+void TimerQueue::armTimerfd(Timestamp when)
 {
-    bool earliestChanged = false;
-    Timestamp when = timer->expiration();
-    if (timers_.begin() == timers_.end() || when < timers_.begin()->first)
-        earliestChanged = true;
-    {
-        std::pair<TimerList::const_iterator, bool> result =
-            timers_.insert(std::make_pair(when, timer));
-        assert(result.second);
-        (void)result;
-    }
+    if (when == armedAt_)
     {
-        std::pair<ActiveTimerSet::const_iterator, bool> result =
-            activeTimers_.insert(std::make_pair(timer, timer->sequence()));
-        assert(result.second);
-        (void)result;
+        return;
     }
-    return earliestChanged;
+    resetTimerfd(timerfd_, when);
+    armedAt_ = when;
 }
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <memory>
 #include <set>
 #include <vector>
 
 #include "Timestamp.h"
 #include "Timer.h"
 #include "Channel.h"
+#include "TimerBackend.h"
+#include "TimerPool.h"
 
 class EventLoop;
 class Timer;
@@ -18,13 +21,18 @@ public:
 
     ~TimerQueue();
 
-    /* 任何线程都可以调用addTimer，非线程安全，但真正把Timer加入队列的只有原IO线程 */
-    TimerId addTimer(Timestamp timestamp, const TimerCallback &cb, double interval);
+    /*
+     * 任何线程都可以调用addTimer，非线程安全，但真正把Timer加入队列的只有原IO线程；timestamp是单调时钟；
+     * slack是允许推迟的秒数，见Timer
+     */
+    TimerId addTimer(Timestamp timestamp, const TimerCallback &cb, double interval, double slack = 0.0);
     void cancel(TimerId timerId);
 
+    /* 切换保存定时器的后端，已有的定时器原样迁移过去，只能在loop线程中调用 */
+    void setBackend(TimerBackend::Type type);
+    const char *backendName() const { return backend_->name(); }
+
 private:
-    using Entry = std::pair<Timestamp, Timer *>;
-    using TimerList = std::set<Entry>;
     using ActiveTimer = std::pair<Timer *, int64_t>;
     using ActiveTimerSet = std::set<ActiveTimer>;
 
@@ -35,28 +43,26 @@ private:
     /* timerfd在满足到期时间后就处理读事件 */
     void handleRead();
 
-    std::vector<Entry> getExpired(Timestamp now);
-
     /*
      * 处理一批已执行的到期Timers，
      * 定期Timers重置到期时间并重新加入队列，
      * 一次性Timers则释放资源
      */
-    void reset(std::vector<Entry> &&expired, Timestamp now);
-    /* 插入timers_队列前检查到期时间的优先级并返回是否最先到期 */
-    bool insert(Timer *timer);
+    void reset(std::vector<Timer *> &expired, Timestamp now);
+    /* 按后端的下一次唤醒时间设置timerfd */
+    void rearm();
+    /* 与已设置的时刻相同时省去timerfd_settime */
+    void armTimerfd(Timestamp when);
 
     EventLoop *loop_;
     const int timerfd_;
     Channel timerChannel_;
     bool callingExpiredTimers_;
+    Timestamp armedAt_; // timerfd当前设置的到期时刻，触发后无效
 
-    /* 用set来排序优先到期的定时器，
-     * 通过时间戳获取Timer指针-> pair<Timestamp,Timer*>,
-     * 用pair作为元素是因为Timerstamp有可能相同，而相同Timerstamp的pair的地址却不同
-     */
-    TimerList timers_;
-    /* 用以注销或激活定时器的集合,容器保存的都是有效指针 */
-    ActiveTimerSet activeTimers_;
+    TimerPool pool_; // 先于backend_构造，后于它析构
+    std::unique_ptr<TimerBackend> backend_;
+    std::vector<Timer *> expired_; // 复用的到期列表，避免每次触发都分配
+    /* 正在执行到期回调时被取消的定时器，不再重新加入 */
     ActiveTimerSet cancelingTimers_;
 };
\ No newline at end of file
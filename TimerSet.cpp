@@ -0,0 +1,58 @@
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+
+#include "TimerSet.h"
+#include "Timer.h"
+
+bool TimerSet::insert(Timer *timer)
+{
+    bool earliestChanged = false;
+    Timestamp when = timer->expiration();
+    if (timers_.begin() == timers_.end() || when < timers_.begin()->first)
+        earliestChanged = true;
+    std::pair<TimerList::const_iterator, bool> result =
+        timers_.insert(std::make_pair(when, timer));
+    assert(result.second);
+    (void)result;
+    timer->setPosition(0, 0);
+    return earliestChanged;
+}
+
+void TimerSet::erase(Timer *timer)
+{
+    size_t n = timers_.erase(Entry(timer->expiration(), timer));
+    assert(n == 1);
+    (void)n;
+    timer->setPosition(-1, 0);
+}
+
+void TimerSet::popExpired(Timestamp now, std::vector<Timer *> *expired)
+{
+    /* 设定一个当前时间的哨兵值，得到第一个不早于它的Timer迭代器 */
+    Entry sentry = std::make_pair(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+    TimerList::iterator last = timers_.lower_bound(sentry);
+    assert(last == timers_.end() || now < last->first);
+
+    for (TimerList::iterator it = timers_.begin(); it != last; ++it)
+    {
+        it->second->setPosition(-1, 0);
+        expired->push_back(it->second);
+    }
+    timers_.erase(timers_.begin(), last);
+}
+
+Timestamp TimerSet::nextWakeup()
+{
+    return timers_.empty() ? Timestamp::invalid() : timers_.begin()->first;
+}
+
+void TimerSet::takeAll(std::vector<Timer *> *timers)
+{
+    for (const Entry &it : timers_)
+    {
+        it.second->setPosition(-1, 0);
+        timers->push_back(it.second);
+    }
+    timers_.clear();
+}
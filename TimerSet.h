@@ -0,0 +1,31 @@
+#pragma once
+
+#include <set>
+
+#include "TimerBackend.h"
+
+/**
+ * 用set来排序优先到期的定时器，
+ * 通过时间戳获取Timer指针-> pair<Timestamp,Timer*>,
+ * 用pair作为元素是因为Timerstamp有可能相同，而相同Timerstamp的pair的地址却不同
+ */
+class TimerSet : public TimerBackend
+{
+public:
+    TimerSet() = default;
+    ~TimerSet() override = default;
+
+    bool insert(Timer *timer) override;
+    void erase(Timer *timer) override;
+    void popExpired(Timestamp now, std::vector<Timer *> *expired) override;
+    Timestamp nextWakeup() override;
+    size_t size() const override { return timers_.size(); }
+    void takeAll(std::vector<Timer *> *timers) override;
+    const char *name() const override { return "set"; }
+
+private:
+    using Entry = std::pair<Timestamp, Timer *>;
+    using TimerList = std::set<Entry>;
+
+    TimerList timers_;
+};
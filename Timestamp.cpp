@@ -1,4 +1,6 @@
 #include <sys/time.h>
+#include <time.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "Timestamp.h"
@@ -20,6 +22,13 @@ Timestamp Timestamp::now()
     return Timestamp((seconds * kMicroSecondsPerSecond) + tv.tv_usec);
 }
 
+Timestamp Timestamp::monotonicNow()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
 std::string Timestamp::toString() const
 {
     char buf[32];
@@ -29,20 +38,44 @@ std::string Timestamp::toString() const
     return buf;
 }
 
-std::string Timestamp::toFormattedString() const
+namespace
+{
+    /* 每个线程缓存最近一秒的"YYYY/MM/DD HH:MM:SS"，同一秒内只需改写微秒部分 */
+    __thread time_t t_lastSecond = -1;
+    __thread char t_dateTime[64];
+}
+
+size_t Timestamp::formatTo(char *buf) const
 {
-    char buf[64];
     time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
     int microSeconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
-    struct tm tm_time;
-    gmtime_r(&seconds, &tm_time);
-    snprintf(buf, sizeof(buf), "%4d/%02d/%02d %02d:%02d:%02d.%06d",
-             tm_time.tm_year + 1900,
-             tm_time.tm_mon + 1,
-             tm_time.tm_mday,
-             tm_time.tm_hour,
-             tm_time.tm_min,
-             tm_time.tm_sec,
-             microSeconds);
-    return buf;
-}
\ No newline at end of file
+    if (seconds != t_lastSecond)
+    {
+        struct tm tm_time;
+        gmtime_r(&seconds, &tm_time);
+        snprintf(t_dateTime, sizeof(t_dateTime), "%4d/%02d/%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900,
+                 tm_time.tm_mon + 1,
+                 tm_time.tm_mday,
+                 tm_time.tm_hour,
+                 tm_time.tm_min,
+                 tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+    memcpy(buf, t_dateTime, 19);
+    buf[19] = '.';
+    for (int i = 25; i > 19; --i)
+    {
+        buf[i] = static_cast<char>('0' + microSeconds % 10);
+        microSeconds /= 10;
+    }
+    buf[26] = '\0';
+    return 26;
+}
+
+std::string Timestamp::toFormattedString() const
+{
+    char buf[kFormattedSize];
+    size_t len = formatTo(buf);
+    return std::string(buf, len);
+}
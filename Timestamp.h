@@ -21,7 +21,12 @@ public:
     std::string toString() const;
     //返回现实时间戳 
     std::string toFormattedString() const;
+    /* 把"YYYY/MM/DD HH:MM:SS.uuuuuu"写入buf(至少kFormattedSize字节，含结尾'\0')，返回不含'\0'的长度 */
+    size_t formatTo(char *buf) const;
+    static const size_t kFormattedSize = 27;
     static Timestamp now();
+    /* 单调时钟(CLOCK_MONOTONIC，走vDSO)，不受NTP和手动调时影响，只用于计算间隔和定时器到期时间 */
+    static Timestamp monotonicNow();
     static Timestamp invalid() { return Timestamp(); }
     bool isValid() { return microSecondsSinceEpoch_ > 0; }
 
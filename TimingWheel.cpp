@@ -0,0 +1,261 @@
+#include <assert.h>
+#include <algorithm>
+
+#include "TimingWheel.h"
+#include "Timer.h"
+
+namespace
+{
+/* 到期时间向上取整到刻度，保证不会提前触发 */
+uint64_t tickOf(Timestamp when)
+{
+    int64_t us = when.microSecondsSinceEpoch();
+    return us <= 0 ? 0 : static_cast<uint64_t>((us + TimingWheel::kTickUs - 1) / TimingWheel::kTickUs);
+}
+} // namespace
+
+TimingWheel::TimingWheel()
+    : buckets_(kNumBuckets),
+      size_(0),
+      currentTick_(static_cast<uint64_t>(Timestamp::monotonicNow().microSecondsSinceEpoch() / kTickUs)),
+      wakeupTick_(0)
+{
+    std::fill(levelCount_, levelCount_ + kLevels, 0);
+}
+
+bool TimingWheel::insert(Timer *timer)
+{
+    if (size_ == 0)
+    {
+        /* 空轮没有推进过，先对齐到当前时间，避免新定时器落到过高的层上 */
+        uint64_t nowTick = static_cast<uint64_t>(Timestamp::monotonicNow().microSecondsSinceEpoch() / kTickUs);
+        currentTick_ = std::max(currentTick_, nowTick);
+    }
+    place(timer);
+    ++size_;
+
+    /* 不论放在哪一层，在到期刻度处理时都会先逐级下移再触发，所以到期刻度就是可用的唤醒时间 */
+    uint64_t tick = std::max(tickOf(timer->expiration()), currentTick_);
+    if (wakeupTick_ != 0)
+    {
+        if (tick >= wakeupTick_)
+        {
+            return false;
+        }
+        wakeupTick_ = tick;
+    }
+    return true;
+}
+
+void TimingWheel::erase(Timer *timer)
+{
+    removeAt(timer->bucket(), timer->index());
+    --size_;
+    /* 唤醒时间只会偏早，多一次空的唤醒，不必重新计算 */
+}
+
+void TimingWheel::popExpired(Timestamp now, std::vector<Timer *> *expired)
+{
+    const uint64_t nowTick = static_cast<uint64_t>(now.microSecondsSinceEpoch() / kTickUs);
+    const size_t first = expired->size();
+
+    while (size_ > 0 && currentTick_ <= nowTick)
+    {
+        if (levelCount_[0] == 0)
+        {
+            /* 第0层为空，跳到最低的非空层下一次下移的边界，中间的刻度没有事情可做 */
+            int level = 1;
+            while (levelCount_[level] == 0)
+            {
+                ++level;
+            }
+            uint64_t period = 1ULL << levelShift(level);
+            uint64_t boundary = (currentTick_ + period - 1) & ~(period - 1);
+            if (boundary > nowTick)
+            {
+                break;
+            }
+            currentTick_ = boundary;
+        }
+
+        int index = static_cast<int>(currentTick_ & (kRootSize - 1));
+        if (index == 0)
+        {
+            for (int level = 1; level < kLevels; ++level)
+            {
+                cascade(level);
+                if (((currentTick_ >> levelShift(level)) & (kLevelSize - 1)) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        expireBucket(index, expired);
+        ++currentTick_;
+    }
+    if (currentTick_ <= nowTick)
+    {
+        currentTick_ = nowTick + 1;
+    }
+    wakeupTick_ = 0;
+
+    /* 同一批内按到期时间排序，相同时先加入的先触发 */
+    if (expired->size() - first > 1)
+    {
+        std::sort(expired->begin() + first, expired->end(), [](Timer *lhs, Timer *rhs)
+                  { return lhs->expiration() < rhs->expiration() ||
+                           (!(rhs->expiration() < lhs->expiration()) && lhs->sequence() < rhs->sequence()); });
+    }
+}
+
+Timestamp TimingWheel::nextWakeup()
+{
+    if (size_ == 0)
+    {
+        return Timestamp::invalid();
+    }
+    if (wakeupTick_ == 0)
+    {
+        wakeupTick_ = earliestTick();
+    }
+    return Timestamp(static_cast<int64_t>(wakeupTick_) * kTickUs);
+}
+
+void TimingWheel::takeAll(std::vector<Timer *> *timers)
+{
+    for (Bucket &bucket : buckets_)
+    {
+        for (Timer *timer : bucket)
+        {
+            timer->setPosition(-1, 0);
+            timers->push_back(timer);
+        }
+        bucket.clear();
+    }
+    std::fill(levelCount_, levelCount_ + kLevels, 0);
+    size_ = 0;
+    wakeupTick_ = 0;
+}
+
+void TimingWheel::place(Timer *timer)
+{
+    uint64_t tick = tickOf(timer->expiration());
+    int bucket;
+    if (tick < currentTick_)
+    {
+        /* 已经到期的放在下一个待处理的槽 */
+        bucket = static_cast<int>(currentTick_ & (kRootSize - 1));
+    }
+    else if (tick - currentTick_ < static_cast<uint64_t>(kRootSize))
+    {
+        bucket = static_cast<int>(tick & (kRootSize - 1));
+    }
+    else
+    {
+        uint64_t delta = tick - currentTick_;
+        int level = 1;
+        while (level < kLevels - 1 && delta >= (1ULL << levelShift(level + 1)))
+        {
+            ++level;
+        }
+        const uint64_t maxDelta = (1ULL << (levelShift(kLevels - 1) + kLevelBits)) - 1;
+        if (delta > maxDelta)
+        {
+            tick = currentTick_ + maxDelta; // 超出范围的先放在最高层最远的槽，下移时按真实时间重新分配
+        }
+        bucket = kRootSize + (level - 1) * kLevelSize +
+                 static_cast<int>((tick >> levelShift(level)) & (kLevelSize - 1));
+    }
+    timer->setPosition(bucket, buckets_[bucket].size());
+    buckets_[bucket].push_back(timer);
+    ++levelCount_[bucketLevel(bucket)];
+}
+
+void TimingWheel::removeAt(int bucket, size_t index)
+{
+    Bucket &slot = buckets_[bucket];
+    assert(index < slot.size());
+    slot[index]->setPosition(-1, 0);
+    if (index + 1 != slot.size())
+    {
+        slot[index] = slot.back();
+        slot[index]->setPosition(bucket, index);
+    }
+    slot.pop_back();
+    --levelCount_[bucketLevel(bucket)];
+}
+
+void TimingWheel::cascade(int level)
+{
+    int bucket = kRootSize + (level - 1) * kLevelSize +
+                 static_cast<int>((currentTick_ >> levelShift(level)) & (kLevelSize - 1));
+    if (buckets_[bucket].empty())
+    {
+        return;
+    }
+    Bucket timers;
+    timers.swap(buckets_[bucket]);
+    levelCount_[level] -= timers.size();
+    for (Timer *timer : timers)
+    {
+        place(timer);
+    }
+    /* 把容量还给原来的槽，下一圈不必重新分配 */
+    timers.clear();
+    buckets_[bucket].swap(timers);
+}
+
+void TimingWheel::expireBucket(int bucket, std::vector<Timer *> *expired)
+{
+    Bucket &slot = buckets_[bucket];
+    for (Timer *timer : slot)
+    {
+        timer->setPosition(-1, 0);
+        expired->push_back(timer);
+    }
+    levelCount_[0] -= slot.size();
+    size_ -= slot.size();
+    slot.clear();
+}
+
+uint64_t TimingWheel::earliestTick() const
+{
+    assert(size_ > 0);
+    uint64_t earliest = UINT64_MAX;
+    if (levelCount_[0] > 0)
+    {
+        for (uint64_t tick = currentTick_; tick < currentTick_ + kRootSize; ++tick)
+        {
+            if (!buckets_[tick & (kRootSize - 1)].empty())
+            {
+                earliest = tick;
+                break;
+            }
+        }
+    }
+    /* 高层的定时器在所在槽下移时才需要处理，取各层第一个非空槽的下移刻度 */
+    for (int level = 1; level < kLevels; ++level)
+    {
+        if (levelCount_[level] == 0)
+        {
+            continue;
+        }
+        const int shift = levelShift(level);
+        uint64_t slot = currentTick_ >> shift;
+        if ((currentTick_ & ((1ULL << shift) - 1)) != 0)
+        {
+            ++slot; // 本圈的槽已经下移过
+        }
+        for (int k = 0; k < kLevelSize; ++k)
+        {
+            int bucket = kRootSize + (level - 1) * kLevelSize + static_cast<int>((slot + k) & (kLevelSize - 1));
+            if (!buckets_[bucket].empty())
+            {
+                earliest = std::min(earliest, (slot + k) << shift);
+                break;
+            }
+        }
+    }
+    assert(earliest != UINT64_MAX);
+    return earliest;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "TimerBackend.h"
+
+/**
+ * 分层时间轮(与Linux内核的tvec相同的布局)：
+ * -刻度为kTickUs(1ms)，到期时间向上取整到刻度，所以定时器不会提前触发，最多推迟一个刻度；
+ * -第0层256个槽，每槽一个刻度；第1~4层各64个槽，每槽覆盖下一层一整圈，
+ *  共可表示2^32个刻度(约49天)，更远的定时器先放在最高层，逐级下移时再重新计算；
+ * -currentTick_是下一个待处理的刻度，走到第0层的起点时把上一层对应槽中的定时器重新分配到下层；
+ * -每个槽是一个vector，Timer记录自己所在的槽和下标，取消时与槽尾元素交换后删除，O(1)；
+ * -低层全空时直接跳到下一次需要下移的刻度，长时间没有近期定时器也不会逐个刻度空转。
+ * 一批到期的定时器会按到期时间重新排序，触发顺序与TimerSet一致
+ */
+class TimingWheel : public TimerBackend
+{
+public:
+    static const int64_t kTickUs = 1000;
+
+    TimingWheel();
+    ~TimingWheel() override = default;
+
+    bool insert(Timer *timer) override;
+    void erase(Timer *timer) override;
+    void popExpired(Timestamp now, std::vector<Timer *> *expired) override;
+    Timestamp nextWakeup() override;
+    size_t size() const override { return size_; }
+    void takeAll(std::vector<Timer *> *timers) override;
+    const char *name() const override { return "wheel"; }
+
+private:
+    static const int kLevels = 5;
+    static const int kRootBits = 8;
+    static const int kLevelBits = 6;
+    static const int kRootSize = 1 << kRootBits;
+    static const int kLevelSize = 1 << kLevelBits;
+    static const int kNumBuckets = kRootSize + (kLevels - 1) * kLevelSize;
+
+    using Bucket = std::vector<Timer *>;
+
+    /* 第level层一个槽覆盖的刻度数的log2，第0层为0 */
+    static int levelShift(int level) { return level == 0 ? 0 : kRootBits + (level - 1) * kLevelBits; }
+    static int bucketLevel(int bucket) { return bucket < kRootSize ? 0 : 1 + (bucket - kRootSize) / kLevelSize; }
+
+    /* 根据到期刻度放入对应的槽 */
+    void place(Timer *timer);
+    void removeAt(int bucket, size_t index);
+    /* 把第level层下一圈对应的槽重新分配到下层 */
+    void cascade(int level);
+    void expireBucket(int bucket, std::vector<Timer *> *expired);
+    /* 最早需要处理的刻度，要求size_ > 0 */
+    uint64_t earliestTick() const;
+
+    std::vector<Bucket> buckets_;
+    size_t levelCount_[kLevels]; // 每层的定时器数量
+    size_t size_;
+    uint64_t currentTick_;
+    uint64_t wakeupTick_; // 缓存的earliestTick()，0表示需要重新计算
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+
+#include "Timestamp.h"
+
+/**
+ * 令牌桶限流：
+ * -令牌以rate个/秒的速度补充，最多积攒burst个；
+ * -每次放行消耗一个令牌，桶空则拒绝；
+ * -rate<=0表示不限流。
+ * 非线程安全，由持有者负责加锁
+ */
+class TokenBucket
+{
+public:
+    TokenBucket()
+        : rate_(0.0),
+          burst_(0.0),
+          tokens_(0.0),
+          lastRefill_()
+    {
+    }
+
+    void setRate(double rate, double burst)
+    {
+        rate_ = rate;
+        burst_ = std::max(burst, 1.0);
+        tokens_ = burst_;
+        lastRefill_ = Timestamp::monotonicNow();
+    }
+
+    /* now取单调时钟 */
+    bool tryAcquire(Timestamp now)
+    {
+        if (rate_ <= 0.0)
+        {
+            return true;
+        }
+        double elapsed = static_cast<double>(now.microSecondsSinceEpoch() - lastRefill_.microSecondsSinceEpoch()) /
+                         Timestamp::kMicroSecondsPerSecond;
+        lastRefill_ = now;
+        tokens_ = std::min(burst_, tokens_ + std::max(elapsed, 0.0) * rate_);
+        if (tokens_ < 1.0)
+        {
+            return false;
+        }
+        tokens_ -= 1.0;
+        return true;
+    }
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    Timestamp lastRefill_;
+};
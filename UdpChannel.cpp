@@ -0,0 +1,261 @@
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "UdpChannel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+namespace
+{
+    /* 每个数据报的控制信息只需容纳SO_RXQ_OVFL的计数 */
+    const size_t kControlSize = CMSG_SPACE(sizeof(uint32_t));
+}
+
+UdpChannel::UdpChannel(EventLoop *loop, const InetAddress &bindAddr, bool reuseport, size_t maxDatagramSize)
+    : loop_(loop),
+      socket_(Socket::createNonblockingDatagram(bindAddr.family())),
+      channel_(loop, socket_.fd()),
+      localAddr_(bindAddr),
+      maxDatagramSize_(maxDatagramSize),
+      recvPool_(kMaxBatch * maxDatagramSize),
+      recvMsgs_(kMaxBatch),
+      recvIovecs_(kMaxBatch),
+      recvAddrs_(kMaxBatch),
+      recvControl_(kMaxBatch * kControlSize),
+      sendPool_(kMaxBatch * maxDatagramSize),
+      sendMsgs_(kMaxBatch),
+      sendIovecs_(kMaxBatch),
+      sendAddrs_(kMaxBatch),
+      numPending_(0),
+      flushQueued_(false),
+      handlingRead_(false),
+      received_(0),
+      sent_(0),
+      truncated_(0),
+      rxQueueDrops_(0),
+      sendDrops_(0),
+      alive_(std::make_shared<bool>(true))
+{
+    if (!bindAddr.isUnix())
+    {
+        socket_.setReuseAddr(true);
+        socket_.setReusePort(reuseport);
+    }
+    int on = 1;
+    if (::setsockopt(socket_.fd(), SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+    {
+        LOG_ERROR("UdpChannel::setsockopt(SO_RXQ_OVFL) failed");
+    }
+    socket_.bindAddress(bindAddr);
+    localAddr_ = Socket::getLocalAddr(socket_.fd()); // 端口为0时取得内核分配的端口
+
+    /* 各个mmsghdr固定指向池中的同一位置，每次收发前只需重置长度 */
+    for (int i = 0; i < kMaxBatch; ++i)
+    {
+        recvIovecs_[i].iov_base = recvPool_.data() + i * maxDatagramSize_;
+        recvIovecs_[i].iov_len = maxDatagramSize_;
+        struct msghdr &rmsg = recvMsgs_[i].msg_hdr;
+        memset(&rmsg, 0, sizeof(rmsg));
+        rmsg.msg_name = &recvAddrs_[i];
+        rmsg.msg_iov = &recvIovecs_[i];
+        rmsg.msg_iovlen = 1;
+        rmsg.msg_control = recvControl_.data() + i * kControlSize;
+
+        sendIovecs_[i].iov_base = sendPool_.data() + i * maxDatagramSize_;
+        struct msghdr &smsg = sendMsgs_[i].msg_hdr;
+        memset(&smsg, 0, sizeof(smsg));
+        smsg.msg_name = &sendAddrs_[i];
+        smsg.msg_iov = &sendIovecs_[i];
+        smsg.msg_iovlen = 1;
+    }
+    channel_.setReadCallback(std::bind(&UdpChannel::handleRead, this, std::placeholders::_1));
+}
+
+UdpChannel::~UdpChannel()
+{
+    /* socket_析构时关闭套接字，Channel必须已经在loop线程中移除；仍在loop中排队的flush()/sendInLoop()随之失效 */
+    alive_.reset();
+}
+
+void UdpChannel::start()
+{
+    loop_->assertInLoopThread();
+    channel_.enableReading();
+}
+
+void UdpChannel::stop()
+{
+    loop_->assertInLoopThread();
+    flush();
+    if (!channel_.isNoneEvents())
+    {
+        channel_.disableAll();
+        channel_.remove();
+    }
+}
+
+void UdpChannel::handleRead(Timestamp receiveTime)
+{
+    loop_->assertInLoopThread();
+    for (int i = 0; i < kMaxBatch; ++i)
+    {
+        struct msghdr &msg = recvMsgs_[i].msg_hdr;
+        msg.msg_namelen = sizeof(struct sockaddr_storage);
+        msg.msg_controllen = kControlSize;
+        msg.msg_flags = 0;
+    }
+    /* 水平触发，没收完的数据报留给下一轮poll，避免饿死同一loop上的其他Channel */
+    int n = ::recvmmsg(socket_.fd(), recvMsgs_.data(), kMaxBatch, MSG_DONTWAIT, NULL);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            LOG_ERROR("UdpChannel::handleRead recvmmsg() errno = %d", errno);
+        }
+        return;
+    }
+
+    handlingRead_ = true;
+    for (int i = 0; i < n; ++i)
+    {
+        struct msghdr &msg = recvMsgs_[i].msg_hdr;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+            {
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                rxQueueDrops_.store(drops, std::memory_order_relaxed);
+            }
+        }
+        if (msg.msg_flags & MSG_TRUNC)
+        {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        received_.fetch_add(1, std::memory_order_relaxed);
+        if (messageCb_)
+        {
+            InetAddress peerAddr(reinterpret_cast<const sockaddr *>(&recvAddrs_[i]), msg.msg_namelen);
+            messageCb_(this, static_cast<const char *>(recvIovecs_[i].iov_base), recvMsgs_[i].msg_len,
+                       peerAddr, receiveTime);
+        }
+    }
+    handlingRead_ = false;
+    /* 回调中产生的应答合并成一次sendmmsg() */
+    flush();
+}
+
+void UdpChannel::send(const void *data, size_t len, const InetAddress &peerAddr)
+{
+    if (loop_->isInLoopThread())
+    {
+        queueDatagram(static_cast<const char *>(data), len, peerAddr);
+    }
+    else
+    {
+        std::weak_ptr<bool> alive(alive_);
+        std::string message(static_cast<const char *>(data), len);
+        loop_->runInLoop([this, alive, message, peerAddr]()
+                         {
+                             if (!alive.expired())
+                             {
+                                 sendInLoop(message, peerAddr);
+                             }
+                         });
+    }
+}
+
+void UdpChannel::sendInLoop(const std::string &message, const InetAddress &peerAddr)
+{
+    queueDatagram(message.data(), message.size(), peerAddr);
+}
+
+void UdpChannel::queueDatagram(const char *data, size_t len, const InetAddress &peerAddr)
+{
+    loop_->assertInLoopThread();
+    if (len > maxDatagramSize_)
+    {
+        /* 放不进发送池的大数据报先保证顺序，再单独发送 */
+        flush();
+        if (::sendto(socket_.fd(), data, len, 0, peerAddr.getSockaddr(), peerAddr.getSockaddrLen()) < 0)
+        {
+            sendDrops_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            sent_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (numPending_ == kMaxBatch)
+    {
+        flush();
+    }
+    int i = numPending_++;
+    memcpy(sendIovecs_[i].iov_base, data, len);
+    sendIovecs_[i].iov_len = len;
+    memcpy(&sendAddrs_[i], peerAddr.getSockaddr(), peerAddr.getSockaddrLen());
+    sendMsgs_[i].msg_hdr.msg_namelen = peerAddr.getSockaddrLen();
+
+    /* 不在读回调中时(如定时器或其他线程投递)，等本轮循环的其他任务完成后再统一发送 */
+    if (!handlingRead_ && !flushQueued_)
+    {
+        flushQueued_ = true;
+        std::weak_ptr<bool> alive(alive_);
+        loop_->queueInLoop([this, alive]()
+                           {
+                               if (!alive.expired())
+                               {
+                                   flush();
+                               }
+                           });
+    }
+}
+
+void UdpChannel::flush()
+{
+    loop_->assertInLoopThread();
+    flushQueued_ = false;
+    int sent = 0;
+    while (sent < numPending_)
+    {
+        int n = ::sendmmsg(socket_.fd(), sendMsgs_.data() + sent, numPending_ - sent, MSG_DONTWAIT);
+        if (n > 0)
+        {
+            sent_.fetch_add(n, std::memory_order_relaxed);
+            sent += n;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == ENOBUFS))
+        {
+            /* UDP不保证送达，发送缓冲区满时丢弃剩余的数据报而不是挂起等待可写 */
+            sendDrops_.fetch_add(numPending_ - sent, std::memory_order_relaxed);
+            break;
+        }
+        else
+        {
+            /* 错误属于第一个未发送的数据报(如ICMP不可达导致的ECONNREFUSED)，跳过它继续发送 */
+            sendDrops_.fetch_add(1, std::memory_order_relaxed);
+            sent++;
+        }
+    }
+    numPending_ = 0;
+}
+
+UdpChannel::Stats UdpChannel::stats() const
+{
+    Stats stats;
+    stats.received = received_.load(std::memory_order_relaxed);
+    stats.sent = sent_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    stats.rxQueueDrops = rxQueueDrops_.load(std::memory_order_relaxed);
+    stats.sendDrops = sendDrops_.load(std::memory_order_relaxed);
+    return stats;
+}
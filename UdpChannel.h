@@ -0,0 +1,100 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <functional>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+#include "Channel.h"
+#include "InetAddress.h"
+#include "Socket.h"
+#include "Timestamp.h"
+#include "noncopyable.h"
+
+class EventLoop;
+
+/**
+ * 绑定在一个EventLoop上的UDP套接字，服务器和客户端都用它收发数据报：
+ * -可读时用一次recvmmsg()收取至多kMaxBatch个数据报，接收缓冲区、地址和控制信息都预先分配并反复使用；
+ * -数据报直接从接收池交给回调，指针只在回调期间有效，需要保留时由用户自己拷贝；
+ * -send()把数据报拷入预分配的发送池，在本轮读事件处理完或loop的本轮循环结束时用sendmmsg()一次发出，
+ *  发送池满时立即发送；
+ * -统计接收、发送、截断，以及内核接收队列溢出(SO_RXQ_OVFL)和发送失败造成的丢包，可在任意线程读取。
+ * 销毁前必须在loop线程中调用stop()，或者loop已经退出
+ */
+class UdpChannel : noncopyable
+{
+public:
+    using MessageCallback = std::function<void(UdpChannel *channel, const char *data, size_t len,
+                                               const InetAddress &peerAddr, Timestamp receiveTime)>;
+    static const int kMaxBatch = 64;                     // 每次系统调用收发的数据报上限
+    static const size_t kDefaultMaxDatagramSize = 2048; // 超过该长度的数据报被截断丢弃
+
+    struct Stats
+    {
+        int64_t received;     // 交给回调的数据报
+        int64_t sent;         // 成功交给内核的数据报
+        int64_t truncated;    // 超过maxDatagramSize被丢弃的数据报
+        int64_t rxQueueDrops; // 内核因接收队列满而丢弃的数据报(累计值)
+        int64_t sendDrops;    // 发送失败(EAGAIN/ENOBUFS等)而丢弃的数据报
+    };
+
+    /* bindAddr的端口为0时由内核分配，适合客户端；reuseport为true时多个UdpChannel可以绑定同一地址 */
+    UdpChannel(EventLoop *loop, const InetAddress &bindAddr, bool reuseport = false,
+               size_t maxDatagramSize = kDefaultMaxDatagramSize);
+    ~UdpChannel();
+
+    void setMessageCallback(const MessageCallback &cb) { messageCb_ = std::move(cb); }
+    void start(); // 开始接收，必须在loop线程中调用
+    /* 停止接收并发出发送池中的数据报，必须在loop线程中调用；之后即可在loop线程中销毁，已投递而未执行的发送任务会被忽略 */
+    void stop();
+
+    /* 线程安全，其他线程调用时会拷贝一次数据 */
+    void send(const void *data, size_t len, const InetAddress &peerAddr);
+    void send(const std::string &message, const InetAddress &peerAddr) { send(message.data(), message.size(), peerAddr); }
+    void flush(); // 立即发出发送池中的数据报，必须在loop线程中调用
+
+    EventLoop *getLoop() const { return loop_; }
+    int fd() const { return socket_.fd(); }
+    const InetAddress &localAddress() const { return localAddr_; }
+    Stats stats() const;
+
+private:
+    void handleRead(Timestamp receiveTime);
+    void sendInLoop(const std::string &message, const InetAddress &peerAddr);
+    void queueDatagram(const char *data, size_t len, const InetAddress &peerAddr);
+
+    EventLoop *loop_;
+    Socket socket_;
+    Channel channel_;
+    InetAddress localAddr_;
+    const size_t maxDatagramSize_;
+    MessageCallback messageCb_;
+
+    /* 接收池，下标与recvMsgs_一一对应 */
+    std::vector<char> recvPool_;
+    std::vector<struct mmsghdr> recvMsgs_;
+    std::vector<struct iovec> recvIovecs_;
+    std::vector<struct sockaddr_storage> recvAddrs_;
+    std::vector<char> recvControl_;
+
+    /* 发送池，前numPending_项是待发送的数据报 */
+    std::vector<char> sendPool_;
+    std::vector<struct mmsghdr> sendMsgs_;
+    std::vector<struct iovec> sendIovecs_;
+    std::vector<struct sockaddr_storage> sendAddrs_;
+    int numPending_;
+    bool flushQueued_;  // 已经通过queueInLoop()安排了flush()
+    bool handlingRead_; // 正在执行读回调，应答由handleRead()末尾统一发送
+
+    std::atomic<int64_t> received_;
+    std::atomic<int64_t> sent_;
+    std::atomic<int64_t> truncated_;
+    std::atomic<int64_t> rxQueueDrops_;
+    std::atomic<int64_t> sendDrops_;
+    /* 投递到loop的任务持有它的weak_ptr，析构后这些任务不再访问本对象 */
+    std::shared_ptr<bool> alive_;
+};
@@ -0,0 +1,63 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name)
+    : loop_(loop),
+      listenAddr_(listenAddr),
+      name_(name),
+      threadPool_(std::make_unique<EventLoopThreadPool>(loop)),
+      maxDatagramSize_(UdpChannel::kDefaultMaxDatagramSize),
+      started_(false)
+{
+}
+
+UdpServer::~UdpServer()
+{
+    /* baseLoop上的分片要在本线程移除Channel，IO线程上的分片随loop退出一并失效 */
+    for (const auto &channel : channels_)
+    {
+        if (channel->getLoop() == loop_)
+        {
+            channel->stop();
+        }
+    }
+}
+
+void UdpServer::start()
+{
+    loop_->assertInLoopThread();
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+    threadPool_->start();
+
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    bool reuseport = loops.size() > 1;
+    for (EventLoop *ioLoop : loops)
+    {
+        channels_.push_back(std::make_unique<UdpChannel>(ioLoop, listenAddr_, reuseport, maxDatagramSize_));
+        UdpChannel *channel = channels_.back().get();
+        channel->setMessageCallback(messageCb_);
+        ioLoop->runInLoop(std::bind(&UdpChannel::start, channel));
+    }
+    LOG_INFO("UdpServer::start[%s] listening on %s with %zu sockets", name_.c_str(),
+             channels_.front()->localAddress().toIpPort().c_str(), channels_.size());
+}
+
+UdpChannel::Stats UdpServer::stats() const
+{
+    UdpChannel::Stats total = {0, 0, 0, 0, 0};
+    for (const auto &channel : channels_)
+    {
+        UdpChannel::Stats stats = channel->stats();
+        total.received += stats.received;
+        total.sent += stats.sent;
+        total.truncated += stats.truncated;
+        total.rxQueueDrops += stats.rxQueueDrops;
+        total.sendDrops += stats.sendDrops;
+    }
+    return total;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "UdpChannel.h"
+#include "noncopyable.h"
+
+class EventLoop;
+
+/**
+ * UDP服务器：
+ * -有IO线程时每个IO线程各持有一个绑定同一地址的SO_REUSEPORT套接字，
+ *  内核按四元组把数据报散列到各个套接字，同一对端总落在同一个IO线程上，线程间无需共享状态；
+ * -没有IO线程时只在baseLoop上创建一个套接字；
+ * -回调在收到数据报的IO线程中执行，应答通过回调参数中的UdpChannel发送。
+ */
+class UdpServer : noncopyable
+{
+public:
+    UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name);
+    ~UdpServer();
+
+    void setThreadNum(int threadNum) { threadPool_->setThreadNum(threadNum); }
+    void setMessageCallback(const UdpChannel::MessageCallback &cb) { messageCb_ = std::move(cb); }
+    /* 需要在start()之前设置 */
+    void setMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+    void start();
+
+    const std::string &name() const { return name_; }
+    /* start()之后才有效，每个分片一个，可以在任意线程读取其统计 */
+    size_t numChannels() const { return channels_.size(); }
+    const UdpChannel *channel(size_t i) const { return channels_[i].get(); }
+    UdpChannel::Stats stats() const; // 所有分片的统计之和
+
+private:
+    EventLoop *loop_;
+    const InetAddress listenAddr_;
+    const std::string name_;
+    /* 声明在threadPool_之前，保证在IO线程退出后才析构 */
+    std::vector<std::unique_ptr<UdpChannel>> channels_;
+    std::unique_ptr<EventLoopThreadPool> threadPool_;
+    UdpChannel::MessageCallback messageCb_;
+    size_t maxDatagramSize_;
+    bool started_;
+};
@@ -46,14 +46,11 @@ public:
     }
 
 private:
-    using StringMeassageCallback = std::function<void(const TcpConnectionPtr &conn,
-                                                      const std::string &message,
-                                                      Timestamp receiveTime)>;
     void onStringMessage(const TcpConnectionPtr &conn,
-                         const std::string &message,
+                         std::string_view message,
                          Timestamp receiveTime)
     {
-        printf("<<< %s\n", message.c_str());
+        printf("<<< %.*s\n", static_cast<int>(message.size()), message.data());
     }
     void onConnection(const TcpConnectionPtr &conn)
     {
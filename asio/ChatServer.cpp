@@ -35,29 +35,23 @@ private:
                  conn->localAddress().toIpPort().c_str(),
                  conn->peerAddress().toIpPort().c_str(),
                  conn->connected() ? "UP" : "DOWN");
-        if (conn->connected())
-        {
-            connections_.insert(conn);
-        }
-        else
-        {
-            connections_.erase(conn);
-        }
     }
     void onStringMessage(const TcpConnectionPtr &conn,
-                         const std::string &message,
+                         std::string_view message,
                          Timestamp)
     {
-        for (const auto &it : connections_)
-        {
-            codec_.send(it, message);
-        }
+        /**
+         * 在每个连接所属的IO线程中发送，不必在各线程间共享连接集合，消息帧直接写入各连接的输出缓冲区；
+         * message在回调返回后失效，拷贝一份由各IO线程共享
+         */
+        LengthHeaderCodec *codec = &codec_;
+        auto shared = std::make_shared<const std::string>(message);
+        server_.forEachConnectionInLoop([codec, shared](const TcpConnectionPtr &it)
+                                        { codec->send(it, *shared); });
     }
-    using ConnectionList = std::set<TcpConnectionPtr>;
     TcpServer server_;
     EventLoop *loop_;
     LengthHeaderCodec codec_;
-    ConnectionList connections_;
 };
 
 int main(int argc, char *argv[])
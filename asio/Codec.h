@@ -1,64 +1,96 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <string_view>
+#include <string.h>
 #include <arpa/inet.h>
-#include "TcpConnection.h"
-#include "Buffer.h"
-#include "noncopyable.h"
-#include "Timestamp.h"
-#include "Logger.h"
+#include "muduo_rebuild/TcpConnection.h"
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/Buffer.h"
+#include "muduo_rebuild/noncopyable.h"
+#include "muduo_rebuild/Timestamp.h"
+#include "muduo_rebuild/Logger.h"
 
-/* 解决TCP粘包问题 - 在消息头部编码或解析消息长度 */
+/**
+ * 解决TCP粘包问题 - 在消息头部编码或解析消息长度(4字节网络字节序)：
+ * -收到的消息以string_view交给回调，直接指向连接的输入缓冲区，只在回调期间有效，需要保留时自行拷贝；
+ * -在IO线程中send()时消息头和消息体直接写入连接的输出缓冲区，不经过临时Buffer；
+ *  其他线程中send()组装成一整帧后移动到IO线程，只拷贝一次；
+ * -消息长度超过maxFrameLength的连接被视为协议错误而关闭，收发双方应使用相同的上限。
+ */
 class LengthHeaderCodec : noncopyable
 {
 public:
     using StringMessageCallback =
         std::function<void(const TcpConnectionPtr &conn,
-                           const std::string &message,
+                           std::string_view message,
                            Timestamp)>;
-    explicit LengthHeaderCodec(const StringMessageCallback &cb)
-        : messageCallback_(cb)
+
+    static const size_t kDefaultMaxFrameLength = 64 * 1024;
+
+    explicit LengthHeaderCodec(const StringMessageCallback &cb,
+                               size_t maxFrameLength = kDefaultMaxFrameLength)
+        : messageCallback_(cb),
+          maxFrameLength_(maxFrameLength)
     {
     }
 
+    void setMaxFrameLength(size_t maxFrameLength) { maxFrameLength_ = maxFrameLength; }
+    size_t maxFrameLength() const { return maxFrameLength_; }
+
     void onMessage(const TcpConnectionPtr &conn,
                    Buffer *buffer,
                    Timestamp receiveTime)
     {
         while (buffer->readableBytes() >= kHeaderLen)
         {
-            const void *data = buffer->peek();
-            const int32_t be32 = *static_cast<const int32_t *>(data);
-            const int32_t len = ntohl(be32);
-            if (len > 65536 || len < 0)
+            uint32_t be32;
+            ::memcpy(&be32, buffer->peek(), sizeof(be32)); // 消息头不一定对齐
+            const uint32_t len = ntohl(be32);
+            if (len > maxFrameLength_)
             {
-                LOG_ERROR("Invalid length: %d", len);
+                LOG_ERROR("Invalid length: %u", len);
                 conn->shutdown();
                 break;
             }
-            else if (buffer->readableBytes() >= len + kHeaderLen)
+            else if (buffer->readableBytes() >= kHeaderLen + len)
             {
-                buffer->retrieve(kHeaderLen);
-                std::string message(buffer->peek(), len);
-                messageCallback_(conn, message, receiveTime);
-                buffer->retrieve(len);
+                messageCallback_(conn, std::string_view(buffer->peek() + kHeaderLen, len), receiveTime);
+                buffer->retrieve(kHeaderLen + len);
             }
             else
                 break;
         }
     }
 
-    void send(const TcpConnectionPtr &conn, const std::string &message)
+    void send(const TcpConnectionPtr &conn, std::string_view message)
     {
-        Buffer buffer;
-        buffer.append(message);
-        int32_t len = static_cast<int32_t>(message.size());
-        int32_t be32 = htonl(len);
-        buffer.prepend(&be32, sizeof(be32));
-        conn->send(&buffer);
+        const uint32_t be32 = htonl(static_cast<uint32_t>(message.size()));
+        if (conn->getLoop()->isInLoopThread())
+        {
+            if (!conn->connected())
+            {
+                return;
+            }
+            Buffer *output = conn->outputBuffer();
+            output->ensureWritable(kHeaderLen + message.size());
+            output->append(&be32, kHeaderLen);
+            output->append(message.data(), message.size());
+            conn->flushOutput();
+        }
+        else
+        {
+            /* 其他线程不能访问输出缓冲区 */
+            std::string frame(kHeaderLen + message.size(), '\0');
+            ::memcpy(&frame[0], &be32, kHeaderLen);
+            ::memcpy(&frame[kHeaderLen], message.data(), message.size());
+            conn->send(std::move(frame));
+        }
     }
 
 private:
     StringMessageCallback messageCallback_;
+    size_t maxFrameLength_;
     const static size_t kHeaderLen = sizeof(int32_t);
-};
\ No newline at end of file
+};
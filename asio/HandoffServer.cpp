@@ -0,0 +1,90 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+
+#include "muduo_rebuild/TcpServer.h"
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/TcpConnection.h"
+#include "muduo_rebuild/InetAddress.h"
+#include "muduo_rebuild/SocketHandoff.h"
+#include "muduo_rebuild/Logger.h"
+
+using namespace std::placeholders;
+
+/**
+ * 平滑重启的回显服务器：
+ * 启动时先尝试从path上的旧进程接管监听套接字，没有旧进程时才自己bind端口；
+ * 随后在path上等待下一代进程，被接管后停止accept，等已有连接关闭后退出。
+ * 用法：HandoffServer port threads path，重复运行同一条命令即可完成升级
+ */
+class HandoffServer : noncopyable
+{
+public:
+    HandoffServer(EventLoop *loop, std::unique_ptr<TcpServer> server)
+        : loop_(loop),
+          server_(std::move(server))
+    {
+        server_->setConnectionCallback(
+            std::bind(&HandoffServer::onConnection, this, _1));
+        server_->setMessageCallback(
+            std::bind(&HandoffServer::onMessage, this, _1, _2, _3));
+        server_->setDrainTimeout(30);
+        server_->setDrainedCallback(std::bind(&EventLoop::quit, loop_));
+    }
+    void start(const std::string &path)
+    {
+        server_->start();
+        server_->enableHandoff(path);
+    }
+    void setThreadNum(int num)
+    {
+        server_->setThreadNum(num);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        LOG_INFO("%s -> %s is %s",
+                 conn->localAddress().toIpPort().c_str(),
+                 conn->peerAddress().toIpPort().c_str(),
+                 conn->connected() ? "UP" : "DOWN");
+    }
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        conn->send(buf);
+    }
+
+    EventLoop *loop_;
+    std::unique_ptr<TcpServer> server_;
+};
+
+int main(int argc, char *argv[])
+{
+    printf("pid = %d\n", getpid());
+    if (argc > 3)
+    {
+        EventLoop loop;
+        std::unique_ptr<TcpServer> server;
+        SocketHandoff::Sockets inherited;
+        if (SocketHandoff::receive(argv[3], &inherited))
+        {
+            printf("took over %zu listening sockets from %s\n", inherited.listenFds.size(), argv[3]);
+            server = std::make_unique<TcpServer>(&loop, inherited, TcpServer::kReusePort);
+        }
+        else
+        {
+            InetAddress listenAddr(static_cast<uint16_t>(atoi(argv[1])));
+            server = std::make_unique<TcpServer>(&loop, listenAddr, TcpServer::kReusePort);
+        }
+        HandoffServer handoffServer(&loop, std::move(server));
+        handoffServer.setThreadNum(atoi(argv[2]));
+        handoffServer.start(argv[3]);
+        loop.loop();
+    }
+    else
+    {
+        printf("Usage: %s port threads path\n", argv[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "muduo_rebuild/UdpServer.h"
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/InetAddress.h"
+#include "muduo_rebuild/TimerId.h"
+#include "muduo_rebuild/Logger.h"
+
+/* UDP回显服务器，每隔5秒打印一次收发和丢包统计 */
+static void onMessage(UdpChannel *channel, const char *data, size_t len,
+                      const InetAddress &peerAddr, Timestamp)
+{
+    channel->send(data, len, peerAddr);
+}
+
+static void printStats(UdpServer *server)
+{
+    UdpChannel::Stats stats = server->stats();
+    LOG_INFO("received %ld sent %ld truncated %ld rxQueueDrops %ld sendDrops %ld",
+             stats.received, stats.sent, stats.truncated, stats.rxQueueDrops, stats.sendDrops);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("pid = %d\n", getpid());
+    if (argc > 2)
+    {
+        EventLoop loop;
+        InetAddress listenAddr(static_cast<uint16_t>(atoi(argv[1])));
+        UdpServer server(&loop, listenAddr, "UdpEchoServer");
+        server.setThreadNum(atoi(argv[2]));
+        server.setMessageCallback(onMessage);
+        server.start();
+        loop.runEvery(5.0, std::bind(printStats, &server), 0.5);
+        loop.loop();
+    }
+    else
+    {
+        printf("Usage: %s port threads\n", argv[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <atomic>
+#include <future>
+#include <algorithm>
+
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/EventLoopThread.h"
+#include "muduo_rebuild/TcpServer.h"
+#include "muduo_rebuild/TcpClient.h"
+#include "muduo_rebuild/TcpConnection.h"
+#include "muduo_rebuild/InetAddress.h"
+#include "muduo_rebuild/Timestamp.h"
+#include "muduo_rebuild/TimerId.h"
+#include "muduo_rebuild/noncopyable.h"
+
+/**
+ * 各个压测程序共用的部分：
+ * -服务器运行在主线程的loop(加上可选的IO线程)，客户端运行在另外的若干EventLoopThread中；
+ * -先预热再计时，计时结束后在每个客户端loop中做一次同步，之后才读取各loop的统计，不需要加锁；
+ * -结果以一行JSON输出到stdout，日志行以'['开头，用 grep '^{' 即可筛出结果。
+ */
+
+inline int64_t nowUs() { return Timestamp::now().microSecondsSinceEpoch(); }
+
+/* 记录每条消息的延迟(微秒)，只在所属loop线程中写入 */
+class LatencyRecorder
+{
+public:
+    LatencyRecorder() { samples_.reserve(1 << 16); }
+
+    void record(int64_t us) { samples_.push_back(us); }
+    void merge(const LatencyRecorder &other) { samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end()); }
+    size_t count() const { return samples_.size(); }
+
+    /* q取0~1，排序一次后取对应的样本 */
+    int64_t percentile(double q)
+    {
+        if (samples_.empty())
+        {
+            return 0;
+        }
+        if (!sorted_)
+        {
+            std::sort(samples_.begin(), samples_.end());
+            sorted_ = true;
+        }
+        size_t index = static_cast<size_t>(q * static_cast<double>(samples_.size() - 1) + 0.5);
+        return samples_[std::min(index, samples_.size() - 1)];
+    }
+
+private:
+    std::vector<int64_t> samples_;
+    bool sorted_ = false;
+};
+
+/* 每个客户端loop一份，计时期间才累计 */
+struct LoopStats
+{
+    int64_t messages = 0;
+    int64_t bytes = 0;
+    LatencyRecorder latency;
+};
+
+/* params是已格式化的JSON字段，如 "\"sessions\":16,\"size\":64" */
+inline void printResult(const char *bench, const std::string &params, double seconds, LoopStats *total)
+{
+    printf("{\"bench\":\"%s\",%s,\"seconds\":%.2f,\"msgs\":%ld,\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.2f,"
+           "\"p50_us\":%ld,\"p99_us\":%ld,\"p999_us\":%ld}\n",
+           bench, params.c_str(), seconds, total->messages,
+           static_cast<double>(total->messages) / seconds,
+           static_cast<double>(total->bytes) / seconds / (1024 * 1024),
+           total->latency.percentile(0.50), total->latency.percentile(0.99), total->latency.percentile(0.999));
+    fflush(stdout);
+}
+
+/* 客户端IO线程，测量窗口由measuring标志控制 */
+class ClientThreads : noncopyable
+{
+public:
+    explicit ClientThreads(int numThreads)
+        : measuring_(false)
+    {
+        for (int i = 0; i < numThreads; ++i)
+        {
+            threads_.push_back(std::make_unique<EventLoopThread>());
+            loops_.push_back(threads_.back()->startLoop());
+        }
+        stats_.resize(loops_.size());
+    }
+
+    const std::vector<EventLoop *> &loops() const { return loops_; }
+    LoopStats *statsOf(size_t i) { return &stats_[i]; }
+    bool measuring() const { return measuring_.load(std::memory_order_relaxed); }
+    void startMeasuring() { measuring_ = true; }
+
+    /* 停止计时，等每个客户端loop都执行完当前回调后再汇总，保证之后不会再有写入 */
+    LoopStats stopAndCollect()
+    {
+        measuring_ = false;
+        for (EventLoop *loop : loops_)
+        {
+            std::promise<void> done;
+            loop->runInLoop([&done]()
+                            { done.set_value(); });
+            done.get_future().wait();
+        }
+        LoopStats total;
+        for (LoopStats &stats : stats_)
+        {
+            total.messages += stats.messages;
+            total.bytes += stats.bytes;
+            total.latency.merge(stats.latency);
+        }
+        return total;
+    }
+
+private:
+    std::vector<std::unique_ptr<EventLoopThread>> threads_;
+    std::vector<EventLoop *> loops_;
+    std::vector<LoopStats> stats_;
+    std::atomic<bool> measuring_;
+};
+
+/**
+ * 回显压测的一个会话：连接建立后先发出depth条size字节的消息，
+ * 每收回一条就记录其往返延迟并再发一条，使在途消息数保持为depth。
+ * depth为1时即pingpong，depth较大时测的是批量吞吐。
+ */
+class EchoSession : noncopyable
+{
+public:
+    EchoSession(EventLoop *loop, const InetAddress &serverAddr, ClientThreads *threads, LoopStats *stats,
+                size_t size, int depth)
+        : client_(loop, serverAddr, "bench"),
+          threads_(threads),
+          stats_(stats),
+          message_(size, 'x'),
+          depth_(depth)
+    {
+        client_.setConnectionCallback(std::bind(&EchoSession::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&EchoSession::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.connect();
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            for (int i = 0; i < depth_; ++i)
+            {
+                sendTimes_.push_back(nowUs());
+                conn->send(message_);
+            }
+        }
+    }
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        while (buf->readableBytes() >= message_.size())
+        {
+            buf->retrieve(message_.size());
+            int64_t now = nowUs();
+            if (threads_->measuring())
+            {
+                stats_->messages++;
+                stats_->bytes += message_.size();
+                stats_->latency.record(now - sendTimes_.front());
+            }
+            sendTimes_.pop_front();
+            sendTimes_.push_back(now);
+            conn->send(message_);
+        }
+    }
+
+    TcpClient client_;
+    ClientThreads *threads_;
+    LoopStats *stats_;
+    const std::string message_;
+    const int depth_;
+    std::deque<int64_t> sendTimes_; // 在途消息的发送时刻，回显按序到达
+};
+
+inline void onBenchServerConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+inline void onBenchEcho(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+/* 回显压测的默认参数，命令行依次覆盖：服务器线程数 客户端线程数 会话数 消息长度 在途消息数 秒数 */
+struct EchoBenchOptions
+{
+    int serverThreads;
+    int clientThreads;
+    int sessions;
+    size_t size;
+    int depth;
+    double seconds;
+};
+
+inline void parseEchoBenchOptions(EchoBenchOptions *opt, int argc, char *argv[])
+{
+    if (argc > 1)
+        opt->serverThreads = atoi(argv[1]);
+    if (argc > 2)
+        opt->clientThreads = atoi(argv[2]);
+    if (argc > 3)
+        opt->sessions = atoi(argv[3]);
+    if (argc > 4)
+        opt->size = static_cast<size_t>(atoi(argv[4]));
+    if (argc > 5)
+        opt->depth = atoi(argv[5]);
+    if (argc > 6)
+        opt->seconds = atof(argv[6]);
+}
+
+/* 结果中的公共参数字段 */
+inline std::string echoBenchParams(const EchoBenchOptions &opt)
+{
+    char params[256];
+    snprintf(params, sizeof(params),
+             "\"server_threads\":%d,\"client_threads\":%d,\"sessions\":%d,\"size\":%zu,\"depth\":%d",
+             opt.serverThreads, opt.clientThreads, opt.sessions, opt.size, opt.depth);
+    return params;
+}
+
+inline int runEchoBench(const char *bench, EchoBenchOptions opt, int argc, char *argv[])
+{
+    parseEchoBenchOptions(&opt, argc, argv);
+
+    EventLoop loop;
+    InetAddress listenAddr(static_cast<uint16_t>(19982));
+    TcpServer server(&loop, listenAddr);
+    server.setConnectionCallback(onBenchServerConnection);
+    server.setMessageCallback(onBenchEcho);
+    server.setThreadNum(opt.serverThreads);
+    server.start();
+
+    ClientThreads threads(opt.clientThreads);
+    std::vector<std::unique_ptr<EchoSession>> sessions;
+    for (int i = 0; i < opt.sessions; ++i)
+    {
+        size_t n = i % threads.loops().size();
+        sessions.push_back(std::make_unique<EchoSession>(threads.loops()[n], listenAddr, &threads,
+                                                         threads.statsOf(n), opt.size, opt.depth));
+    }
+
+    LoopStats total;
+    loop.runAfter(1.0, std::bind(&ClientThreads::startMeasuring, &threads)); // 预热，等待所有连接建立
+    loop.runAfter(1.0 + opt.seconds, [&]()
+                  {
+                      total = threads.stopAndCollect();
+                      loop.quit(); });
+    loop.loop();
+
+    printResult(bench, echoBenchParams(opt), opt.seconds, &total);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <unistd.h>
+
+#include "BenchCommon.h"
+
+/**
+ * 连接抖动测试：每个会话反复"建立连接-发一条消息-收到回显-服务器关闭连接"，
+ * msgs为完成的连接数，延迟从发起连接开始计到收到回显为止。
+ * 由服务器主动关闭，TIME_WAIT留在服务器一侧，客户端的临时端口不会被耗尽。
+ * 用法：ChurnBench [服务器线程数] [客户端线程数] [每个客户端线程的并发连接数] [秒数]
+ */
+class ChurnSession : noncopyable
+{
+public:
+    ChurnSession(EventLoop *loop, const InetAddress &serverAddr, ClientThreads *threads, LoopStats *stats)
+        : loop_(loop),
+          serverAddr_(serverAddr),
+          threads_(threads),
+          stats_(stats),
+          message_(64, 'c'),
+          startUs_(0)
+    {
+        loop_->runInLoop(std::bind(&ChurnSession::restart, this));
+    }
+
+private:
+    void restart()
+    {
+        /* 上一个TcpClient的回调已经返回，可以安全销毁 */
+        client_ = std::make_unique<TcpClient>(loop_, serverAddr_, "churn");
+        client_->setConnectionCallback(std::bind(&ChurnSession::onConnection, this, std::placeholders::_1));
+        client_->setMessageCallback(std::bind(&ChurnSession::onMessage, this, std::placeholders::_1,
+                                              std::placeholders::_2, std::placeholders::_3));
+        startUs_ = nowUs();
+        client_->connect();
+    }
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->send(message_);
+        }
+        else
+        {
+            loop_->queueInLoop(std::bind(&ChurnSession::restart, this));
+        }
+    }
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        if (buf->readableBytes() >= message_.size())
+        {
+            buf->retrieveAll();
+            if (threads_->measuring())
+            {
+                stats_->messages++;
+                stats_->bytes += message_.size();
+                stats_->latency.record(nowUs() - startUs_);
+            }
+        }
+    }
+
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    ClientThreads *threads_;
+    LoopStats *stats_;
+    const std::string message_;
+    int64_t startUs_;
+    std::unique_ptr<TcpClient> client_;
+};
+
+static void onEchoAndClose(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+    conn->shutdown();
+}
+
+int main(int argc, char *argv[])
+{
+    int serverThreads = argc > 1 ? atoi(argv[1]) : 2;
+    int clientThreads = argc > 2 ? atoi(argv[2]) : 2;
+    int concurrency = argc > 3 ? atoi(argv[3]) : 16;
+    double seconds = argc > 4 ? atof(argv[4]) : 5;
+
+    EventLoop loop;
+    InetAddress listenAddr(static_cast<uint16_t>(19983));
+    TcpServer server(&loop, listenAddr);
+    server.setConnectionCallback(onBenchServerConnection);
+    server.setMessageCallback(onEchoAndClose);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    ClientThreads threads(clientThreads);
+    std::vector<std::unique_ptr<ChurnSession>> sessions;
+    for (size_t n = 0; n < threads.loops().size(); ++n)
+    {
+        for (int i = 0; i < concurrency; ++i)
+        {
+            sessions.push_back(std::make_unique<ChurnSession>(threads.loops()[n], listenAddr, &threads,
+                                                              threads.statsOf(n)));
+        }
+    }
+
+    LoopStats total;
+    loop.runAfter(1.0, std::bind(&ClientThreads::startMeasuring, &threads));
+    loop.runAfter(1.0 + seconds, [&]()
+                  {
+                      total = threads.stopAndCollect();
+                      loop.quit(); });
+    loop.loop();
+
+    char params[128];
+    snprintf(params, sizeof(params), "\"server_threads\":%d,\"client_threads\":%d,\"concurrency\":%d",
+             serverThreads, clientThreads, concurrency);
+    printResult("churn", params, seconds, &total);
+    ::_exit(0); // 会话仍在不停地重建连接，不再逐个析构
+}
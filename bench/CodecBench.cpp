@@ -0,0 +1,114 @@
+#include "BenchCommon.h"
+#include "muduo_rebuild/asio/Codec.h"
+
+/**
+ * LengthHeaderCodec的帧吞吐测试：服务器用codec解出每一帧后原样编码回显，
+ * 客户端同样用codec收发，每个会话保持depth帧在途，msgs_per_sec即为每秒往返的帧数。
+ * 与throughput相比多出的开销就是分帧、回调分发和逐帧编码。
+ * 用法：CodecBench [服务器线程数] [客户端线程数] [会话数] [帧长度] [在途帧数] [秒数]
+ */
+
+namespace
+{
+
+class CodecSession : noncopyable
+{
+public:
+    CodecSession(EventLoop *loop, const InetAddress &serverAddr, ClientThreads *threads, LoopStats *stats,
+                 size_t size, int depth)
+        : client_(loop, serverAddr, "bench"),
+          codec_(std::bind(&CodecSession::onFrame, this, std::placeholders::_1,
+                           std::placeholders::_2, std::placeholders::_3)),
+          threads_(threads),
+          stats_(stats),
+          frame_(size, 'x'),
+          depth_(depth)
+    {
+        if (size > codec_.maxFrameLength())
+        {
+            codec_.setMaxFrameLength(size);
+        }
+        client_.setConnectionCallback(std::bind(&CodecSession::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec_, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.connect();
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            for (int i = 0; i < depth_; ++i)
+            {
+                sendTimes_.push_back(nowUs());
+                codec_.send(conn, frame_);
+            }
+        }
+    }
+    void onFrame(const TcpConnectionPtr &conn, std::string_view frame, Timestamp)
+    {
+        int64_t now = nowUs();
+        if (threads_->measuring())
+        {
+            stats_->messages++;
+            stats_->bytes += frame.size();
+            stats_->latency.record(now - sendTimes_.front());
+        }
+        sendTimes_.pop_front();
+        sendTimes_.push_back(now);
+        codec_.send(conn, frame_);
+    }
+
+    TcpClient client_;
+    LengthHeaderCodec codec_;
+    ClientThreads *threads_;
+    LoopStats *stats_;
+    const std::string frame_;
+    const int depth_;
+    std::deque<int64_t> sendTimes_; // 在途帧的发送时刻，回显按序到达
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    EchoBenchOptions opt = {0, 1, 16, 64, 16, 5};
+    parseEchoBenchOptions(&opt, argc, argv);
+
+    EventLoop loop;
+    InetAddress listenAddr(static_cast<uint16_t>(19982));
+    TcpServer server(&loop, listenAddr);
+    LengthHeaderCodec codec([&codec](const TcpConnectionPtr &conn, std::string_view frame, Timestamp)
+                            { codec.send(conn, frame); });
+    if (opt.size > codec.maxFrameLength())
+    {
+        codec.setMaxFrameLength(opt.size);
+    }
+    server.setConnectionCallback(onBenchServerConnection);
+    server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec, std::placeholders::_1,
+                                        std::placeholders::_2, std::placeholders::_3));
+    server.setThreadNum(opt.serverThreads);
+    server.start();
+
+    ClientThreads threads(opt.clientThreads);
+    std::vector<std::unique_ptr<CodecSession>> sessions;
+    for (int i = 0; i < opt.sessions; ++i)
+    {
+        size_t n = i % threads.loops().size();
+        sessions.push_back(std::make_unique<CodecSession>(threads.loops()[n], listenAddr, &threads,
+                                                          threads.statsOf(n), opt.size, opt.depth));
+    }
+
+    LoopStats total;
+    loop.runAfter(1.0, std::bind(&ClientThreads::startMeasuring, &threads)); // 预热，等待所有连接建立
+    loop.runAfter(1.0 + opt.seconds, [&]()
+                  {
+                      total = threads.stopAndCollect();
+                      loop.quit(); });
+    loop.loop();
+
+    printResult("codec", echoBenchParams(opt), opt.seconds, &total);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "BenchCommon.h"
+
+/**
+ * 广播扇出测试：一个发布者把定长消息发给服务器，服务器用forEachConnectionInLoop()转发给所有连接，
+ * msgs为订阅者收到的消息数，延迟从发布者发出到订阅者收到为止(消息开头8字节是发送时刻)。
+ * 发布者保持depth条消息在途：每当订阅者累计收到的消息数凑满一轮，再发布下一条。
+ * 用法：FanoutBench [服务器线程数] [客户端线程数] [订阅者数] [消息长度] [在途消息数] [秒数]
+ */
+static size_t g_size;
+static TcpServer *g_server;
+
+static void onPublish(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (buf->readableBytes() >= g_size)
+    {
+        std::string message(buf->peek(), g_size);
+        buf->retrieve(g_size);
+        g_server->forEachConnectionInLoop([message](const TcpConnectionPtr &c)
+                                          { c->send(message); });
+    }
+}
+
+class Publisher : noncopyable
+{
+public:
+    Publisher(EventLoop *loop, const InetAddress &serverAddr, size_t size, int depth)
+        : loop_(loop),
+          client_(loop, serverAddr, "publisher"),
+          message_(size, 'p'),
+          depth_(depth)
+    {
+        client_.setConnectionCallback(std::bind(&Publisher::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Publisher::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.connect();
+    }
+    EventLoop *getLoop() const { return loop_; }
+    void start()
+    {
+        for (int i = 0; i < depth_; ++i)
+        {
+            publish();
+        }
+    }
+    void publish()
+    {
+        if (conn_)
+        {
+            int64_t now = nowUs();
+            memcpy(&message_[0], &now, sizeof(now));
+            conn_->send(message_);
+        }
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn) { conn_ = conn->connected() ? conn : TcpConnectionPtr(); }
+    void onMessage(const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); } // 发给自己的副本
+
+    EventLoop *loop_;
+    TcpClient client_;
+    TcpConnectionPtr conn_;
+    std::string message_;
+    const int depth_;
+};
+
+class Subscriber : noncopyable
+{
+public:
+    Subscriber(EventLoop *loop, const InetAddress &serverAddr, ClientThreads *threads, LoopStats *stats,
+               Publisher *publisher, std::atomic<int64_t> *delivered, int numSubscribers)
+        : client_(loop, serverAddr, "subscriber"),
+          threads_(threads),
+          stats_(stats),
+          publisher_(publisher),
+          delivered_(delivered),
+          numSubscribers_(numSubscribers)
+    {
+        client_.setConnectionCallback(std::bind(&Subscriber::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Subscriber::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.connect();
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+        }
+    }
+    void onMessage(const TcpConnectionPtr &, Buffer *buf, Timestamp)
+    {
+        while (buf->readableBytes() >= g_size)
+        {
+            int64_t sentUs;
+            memcpy(&sentUs, buf->peek(), sizeof(sentUs));
+            buf->retrieve(g_size);
+            if (threads_->measuring())
+            {
+                stats_->messages++;
+                stats_->bytes += g_size;
+                stats_->latency.record(nowUs() - sentUs);
+            }
+            /* 订阅者累计收到一整轮，说明有一条消息已经送达所有人，补发一条 */
+            if ((delivered_->fetch_add(1, std::memory_order_relaxed) + 1) % numSubscribers_ == 0)
+            {
+                publisher_->getLoop()->runInLoop(std::bind(&Publisher::publish, publisher_));
+            }
+        }
+    }
+
+    TcpClient client_;
+    ClientThreads *threads_;
+    LoopStats *stats_;
+    Publisher *publisher_;
+    std::atomic<int64_t> *delivered_;
+    const int numSubscribers_;
+};
+
+int main(int argc, char *argv[])
+{
+    int serverThreads = argc > 1 ? atoi(argv[1]) : 2;
+    int clientThreads = argc > 2 ? atoi(argv[2]) : 2;
+    int numSubscribers = argc > 3 ? atoi(argv[3]) : 64;
+    g_size = argc > 4 ? static_cast<size_t>(atoi(argv[4])) : 256;
+    int depth = argc > 5 ? atoi(argv[5]) : 4;
+    double seconds = argc > 6 ? atof(argv[6]) : 5;
+    if (g_size < sizeof(int64_t))
+    {
+        g_size = sizeof(int64_t);
+    }
+
+    EventLoop loop;
+    InetAddress listenAddr(static_cast<uint16_t>(19984));
+    TcpServer server(&loop, listenAddr);
+    g_server = &server;
+    server.setConnectionCallback(onBenchServerConnection);
+    server.setMessageCallback(onPublish);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    ClientThreads threads(clientThreads);
+    Publisher publisher(threads.loops()[0], listenAddr, g_size, depth);
+    std::atomic<int64_t> delivered(0);
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    for (int i = 0; i < numSubscribers; ++i)
+    {
+        size_t n = i % threads.loops().size();
+        subscribers.push_back(std::make_unique<Subscriber>(threads.loops()[n], listenAddr, &threads, threads.statsOf(n),
+                                                           &publisher, &delivered, numSubscribers));
+    }
+
+    LoopStats total;
+    loop.runAfter(1.0, [&]()
+                  {
+                      threads.startMeasuring();
+                      publisher.getLoop()->runInLoop(std::bind(&Publisher::start, &publisher)); });
+    loop.runAfter(1.0 + seconds, [&]()
+                  {
+                      total = threads.stopAndCollect();
+                      loop.quit(); });
+    loop.loop();
+
+    char params[192];
+    snprintf(params, sizeof(params),
+             "\"server_threads\":%d,\"client_threads\":%d,\"subscribers\":%d,\"size\":%zu,\"depth\":%d",
+             serverThreads, clientThreads, numSubscribers, g_size, depth);
+    printResult("fanout", params, seconds, &total);
+    ::_exit(0); // 发布仍在进行，不再逐个析构
+}
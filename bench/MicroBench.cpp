@@ -0,0 +1,518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <atomic>
+#include <future>
+
+#include "muduo_rebuild/Buffer.h"
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/EventLoopThread.h"
+#include "muduo_rebuild/Timestamp.h"
+#include "muduo_rebuild/TimerId.h"
+#include "muduo_rebuild/TimerBackend.h"
+#include "muduo_rebuild/Logger.h"
+#include "muduo_rebuild/AsyncLogging.h"
+#include "muduo_rebuild/BinaryLogging.h"
+#include "muduo_rebuild/ComputePool.h"
+
+/**
+ * 单个组件的微基准，与网络压测不同，每个用例的工作量是固定的操作数而不是固定时长：
+ * -先预热一次，再重复repeats次，输出每次操作耗时的最小值和中位数，最小值受干扰最少，适合比较版本；
+ * -用例可以按名字前缀单独运行，工作量固定，perf stat得到的计数除以ops即为每次操作的开销，例如
+ *    perf stat -e cycles,instructions,cache-misses ./MicroBench -r 1 buffer_readfd
+ * -可选 -c cpu 把主线程(及其后创建的线程)绑到指定CPU上，减少迁移带来的抖动。
+ * 用法: MicroBench [-r repeats] [-c cpu] [-l] [用例名前缀...]
+ */
+
+namespace
+{
+
+inline int64_t nowNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/* run()执行ops次操作并返回计时部分的纳秒数，准备和清理工作不计入 */
+struct MicroCase
+{
+    std::string name;
+    int64_t ops;
+    std::function<int64_t()> run;
+};
+
+const char kPayload[] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+                        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+/* 小消息反复追加，攒够4KB后一次取走，最常见的发送缓冲区用法 */
+int64_t bufferAppendSmall(int64_t ops)
+{
+    Buffer buf;
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        buf.append(kPayload, 64);
+        if (buf.readableBytes() >= 4096)
+        {
+            buf.retrieveAll();
+        }
+    }
+    return nowNs() - start;
+}
+
+/* 缓冲区中始终留有10字节的半条消息，每次追加100字节再取走100字节，
+ * readIndex_不断后移，写满后由makeSpace()把剩余数据挪回头部 */
+int64_t bufferAppendRetrieve(int64_t ops)
+{
+    Buffer buf;
+    buf.append(kPayload, 10);
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        buf.append(kPayload, 100);
+        buf.retrieve(100);
+    }
+    return nowNs() - start;
+}
+
+/* 从初始大小追加到1MB再丢弃，测makeSpace()的扩容分支，每次追加1KB算一次操作 */
+int64_t bufferGrow(int64_t ops)
+{
+    std::string chunk(1024, 'x');
+    const int64_t perBuffer = 1024;
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; i += perBuffer)
+    {
+        Buffer buf;
+        for (int64_t j = 0; j < perBuffer; ++j)
+        {
+            buf.append(chunk);
+        }
+    }
+    return nowNs() - start;
+}
+
+/* 编解码器的典型用法：追加消息体，在前面预留的空间写入4字节长度，再整体取走 */
+int64_t bufferPrepend(int64_t ops)
+{
+    Buffer buf;
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        buf.append(kPayload, 128);
+        int32_t len = 128;
+        buf.prepend(&len, sizeof(len));
+        buf.retrieveAll();
+    }
+    return nowNs() - start;
+}
+
+/* 同一线程内先向socketpair写入chunk字节，再用readFd()读出，包含两次系统调用 */
+int64_t bufferReadFd(int64_t ops, size_t chunk)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+    std::string data(chunk, 'x');
+    Buffer buf;
+    int savedErrno = 0;
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        if (::write(fds[1], data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+        {
+            perror("write");
+            exit(1);
+        }
+        size_t got = 0;
+        while (got < chunk)
+        {
+            ssize_t n = buf.readFd(fds[0], &savedErrno);
+            if (n <= 0)
+            {
+                perror("readFd");
+                exit(1);
+            }
+            got += n;
+        }
+        buf.retrieveAll();
+    }
+    int64_t elapsed = nowNs() - start;
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return elapsed;
+}
+
+/* 在loop线程中注册n个不会到期的定时器再逐个注销，每次注册或注销算一次操作 */
+int64_t timerAddCancel(EventLoop *loop, int64_t n)
+{
+    std::vector<TimerId> ids;
+    ids.reserve(n);
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < n; ++i)
+    {
+        ids.push_back(loop->runAfter(3600.0 + static_cast<double>(i) * 1e-6, []() {}));
+    }
+    for (const TimerId &id : ids)
+    {
+        loop->cancel(id);
+    }
+    return nowNs() - start;
+}
+
+/* 注册n个立即到期的定时器，运行loop直到全部回调执行完，包含注册和到期两部分 */
+int64_t timerExpire(EventLoop *loop, int64_t n)
+{
+    int64_t fired = 0;
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < n; ++i)
+    {
+        loop->runAfter(0.0, [loop, n, &fired]()
+                    {
+                        if (++fired == n)
+                        {
+                            loop->quit();
+                        } });
+    }
+    loop->loop();
+    return nowNs() - start;
+}
+
+/*
+ * 模拟请求超时：先挂上pending个分布在30秒内的定时器，
+ * 再重复n次"注销一个旧的、注册一个新的"，每对注销和注册算一次操作
+ */
+int64_t timerReschedule(EventLoop *loop, int64_t pending, int64_t n)
+{
+    std::vector<TimerId> ids;
+    ids.reserve(pending);
+    uint32_t seed = 12345;
+    auto nextDelay = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return 1.0 + static_cast<double>(seed >> 8 & 0xffff) * 30.0 / 65536.0;
+    };
+    for (int64_t i = 0; i < pending; ++i)
+    {
+        ids.push_back(loop->runAfter(nextDelay(), []() {}));
+    }
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < n; ++i)
+    {
+        size_t k = static_cast<size_t>(i % pending);
+        loop->cancel(ids[k]);
+        ids[k] = loop->runAfter(nextDelay(), []() {});
+    }
+    int64_t elapsed = nowNs() - start;
+    for (const TimerId &id : ids)
+    {
+        loop->cancel(id);
+    }
+    return elapsed;
+}
+
+/* 先切换loop的定时器后端再运行用例 */
+int64_t withTimerBackend(EventLoop *loop, TimerBackend::Type type, const std::function<int64_t()> &run)
+{
+    loop->setTimerBackend(type);
+    return run();
+}
+
+/* producers个线程一共向同一个loop投递ops个任务，计到最后一个任务在loop线程中执行完为止 */
+int64_t queueInLoop(int64_t ops, int producers)
+{
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    int64_t executed = 0; // 只在loop线程中修改
+    std::promise<void> done;
+    std::atomic<bool> go(false);
+    const int64_t perProducer = ops / producers;
+    const int64_t total = perProducer * producers;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 while (!go.load(std::memory_order_acquire))
+                                 {
+                                 }
+                                 for (int64_t i = 0; i < perProducer; ++i)
+                                 {
+                                     loop->queueInLoop([&]()
+                                                       {
+                                                           if (++executed == total)
+                                                           {
+                                                               done.set_value();
+                                                           } });
+                                 } });
+    }
+    int64_t start = nowNs();
+    go.store(true, std::memory_order_release);
+    done.get_future().wait();
+    int64_t elapsed = nowNs() - start;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    return elapsed;
+}
+
+/*
+ * 计算线程池往返：loop线程通过sequencers个Sequencer提交ops个任务，每个任务做约1us的计算，
+ * 结果按序回到loop；每个Sequencer最多window个在途任务，结果回来后再补交，计到最后一个结果执行完为止
+ */
+int64_t computeRoundTrip(EventLoop *loop, int64_t ops, int workers, int sequencers)
+{
+    const int64_t window = 64;
+    ComputePool pool(workers);
+    pool.start();
+    std::vector<ComputePool::SequencerPtr> seqs;
+    for (int i = 0; i < sequencers; ++i)
+    {
+        seqs.push_back(std::make_shared<ComputePool::Sequencer>(loop));
+    }
+    int64_t submitted = 0;
+    int64_t completed = 0;
+    std::function<void(const ComputePool::SequencerPtr &)> refill;
+    refill = [&](const ComputePool::SequencerPtr &seq)
+    {
+        while (submitted < ops && seq->inFlight() < static_cast<size_t>(window))
+        {
+            bool ok = pool.submit(seq, [&, seq]() -> ComputePool::Functor
+                                  {
+                                      volatile uint64_t x = 0;
+                                      for (int k = 0; k < 300; ++k)
+                                      {
+                                          x = x * 31 + k;
+                                      }
+                                      return [&, seq]()
+                                      {
+                                          if (++completed == ops)
+                                          {
+                                              loop->quit();
+                                          }
+                                          refill(seq);
+                                      }; });
+            if (!ok)
+            {
+                break;
+            }
+            ++submitted;
+        }
+    };
+    int64_t start = nowNs();
+    for (const auto &seq : seqs)
+    {
+        refill(seq);
+    }
+    loop->loop();
+    int64_t elapsed = nowNs() - start;
+    pool.stop();
+    return elapsed;
+}
+
+/* 默认输出写stdout，计时期间把stdout重定向到/dev/null，测的是格式化和写入本身的开销 */
+int64_t loggerInfo(int64_t ops)
+{
+    fflush(stdout);
+    std::cout.flush();
+    int savedStdout = ::dup(STDOUT_FILENO);
+    int devNull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    ::dup2(devNull, STDOUT_FILENO);
+    ::close(devNull);
+
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        LOG_INFO("microbench logger line %ld fd=%d %s", i, 42, "payload");
+    }
+    std::cout.flush();
+    int64_t elapsed = nowNs() - start;
+
+    ::dup2(savedStdout, STDOUT_FILENO);
+    ::close(savedStdout);
+    return elapsed;
+}
+
+/* 输出换成AsyncLogging，测前端每次LOG_INFO的开销，日志写到/tmp/MicroBench.*.log */
+int64_t loggerAsync(int64_t ops)
+{
+    AsyncLogging log("/tmp/MicroBench", 512 * 1024 * 1024);
+    log.start();
+    Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, std::placeholders::_1,
+                                           std::placeholders::_2));
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        LOG_INFO("microbench logger line %ld fd=%d %s", i, 42, "payload");
+    }
+    int64_t elapsed = nowNs() - start;
+    Logger::instance().setOutput(Logger::OutputFunc());
+    log.stop();
+    return elapsed;
+}
+
+/* 启用BinaryLogging，前端只记录原始参数，格式化和写文件都在后台线程，日志写到/tmp/MicroBench.*.log */
+int64_t loggerBinary(int64_t ops)
+{
+    BinaryLogging log("/tmp/MicroBench", 512 * 1024 * 1024, 64 * 1024 * 1024);
+    log.start();
+    LOG_INFO("microbench logger_binary start"); // 本线程的环在第一次写日志时创建，不计入
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        LOG_INFO("microbench logger line %ld fd=%d %s", i, 42, "payload");
+    }
+    int64_t elapsed = nowNs() - start;
+    log.stop();
+    if (log.dropped() > 0)
+    {
+        fprintf(stderr, "logger_binary dropped %ld messages\n", log.dropped());
+    }
+    return elapsed;
+}
+
+/* 运行期级别调到ERROR后，被过滤的LOG_INFO只剩一次原子读和比较 */
+int64_t loggerFiltered(int64_t ops)
+{
+    int saved = Logger::logLevel();
+    Logger::setLogLevel(ERROR);
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < ops; ++i)
+    {
+        LOG_INFO("microbench logger line %ld fd=%d %s", i, 42, "payload");
+    }
+    int64_t elapsed = nowNs() - start;
+    Logger::setLogLevel(saved);
+    return elapsed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int repeats = 5;
+    bool listOnly = false;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            repeats = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(atoi(argv[++i]), &set);
+            if (::sched_setaffinity(0, sizeof(set), &set) < 0)
+            {
+                perror("sched_setaffinity");
+            }
+        }
+        else if (strcmp(argv[i], "-l") == 0)
+        {
+            listOnly = true;
+        }
+        else
+        {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    /* 定时器用例共用主线程的loop，loop()可以反复进入 */
+    EventLoop loop;
+
+    std::vector<MicroCase> cases;
+    cases.push_back({"buffer_append_small", 10000000, std::bind(bufferAppendSmall, 10000000)});
+    cases.push_back({"buffer_append_retrieve", 10000000, std::bind(bufferAppendRetrieve, 10000000)});
+    cases.push_back({"buffer_grow_1m", 1048576, std::bind(bufferGrow, 1048576)});
+    cases.push_back({"buffer_prepend", 10000000, std::bind(bufferPrepend, 10000000)});
+    cases.push_back({"buffer_readfd_4k", 200000, std::bind(bufferReadFd, 200000, 4096)});
+    cases.push_back({"buffer_readfd_64k", 20000, std::bind(bufferReadFd, 20000, 65536)});
+    /* 每个定时器用例对各个后端各跑一遍，用例名为timer_<后端>_... */
+    const std::pair<TimerBackend::Type, std::string> backends[] = {
+        {TimerBackend::kSet, "set"},
+        {TimerBackend::kHeap, "heap"},
+        {TimerBackend::kWheel, "wheel"},
+    };
+    for (const auto &backend : backends)
+    {
+        std::string prefix = "timer_" + backend.second + "_";
+        for (int64_t n : {10000, 100000, 1000000})
+        {
+            std::string suffix = n >= 1000000 ? std::to_string(n / 1000000) + "m" : std::to_string(n / 1000) + "k";
+            cases.push_back({prefix + "add_cancel_" + suffix, 2 * n,
+                             std::bind(withTimerBackend, &loop, backend.first,
+                                       std::function<int64_t()>(std::bind(timerAddCancel, &loop, n)))});
+            cases.push_back({prefix + "expire_" + suffix, n,
+                             std::bind(withTimerBackend, &loop, backend.first,
+                                       std::function<int64_t()>(std::bind(timerExpire, &loop, n)))});
+        }
+        cases.push_back({prefix + "reschedule_100k", 1000000,
+                         std::bind(withTimerBackend, &loop, backend.first,
+                                   std::function<int64_t()>(std::bind(timerReschedule, &loop, 100000, 1000000)))});
+    }
+    for (int producers : {1, 2, 4, 8})
+    {
+        cases.push_back({"queue_in_loop_" + std::to_string(producers) + "p", 1000000,
+                         std::bind(queueInLoop, 1000000, producers)});
+    }
+    for (int workers : {1, 2, 4})
+    {
+        cases.push_back({"compute_roundtrip_" + std::to_string(workers) + "w", 200000,
+                         std::bind(computeRoundTrip, &loop, 200000, workers, 16)});
+    }
+    cases.push_back({"logger_info", 200000, std::bind(loggerInfo, 200000)});
+    cases.push_back({"logger_async", 200000, std::bind(loggerAsync, 200000)});
+    cases.push_back({"logger_binary", 200000, std::bind(loggerBinary, 200000)});
+    cases.push_back({"logger_filtered", 100000000, std::bind(loggerFiltered, 100000000)});
+
+    for (MicroCase &c : cases)
+    {
+        bool selected = filters.empty();
+        for (const std::string &f : filters)
+        {
+            selected = selected || c.name.compare(0, f.size(), f) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+        if (listOnly)
+        {
+            printf("%s\n", c.name.c_str());
+            continue;
+        }
+
+        c.run(); // 预热：填充缓存、触发缺页和内存分配器的增长
+        std::vector<double> nsPerOp;
+        for (int r = 0; r < repeats; ++r)
+        {
+            nsPerOp.push_back(static_cast<double>(c.run()) / static_cast<double>(c.ops));
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+        double median = nsPerOp[nsPerOp.size() / 2];
+        printf("{\"bench\":\"micro\",\"case\":\"%s\",\"ops\":%ld,\"repeats\":%d,"
+               "\"ns_per_op_min\":%.2f,\"ns_per_op_median\":%.2f,\"mops_per_sec\":%.3f}\n",
+               c.name.c_str(), c.ops, repeats, nsPerOp.front(), median, 1000.0 / median);
+        fflush(stdout);
+    }
+    return 0;
+}
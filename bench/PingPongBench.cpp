@@ -0,0 +1,11 @@
+#include "BenchCommon.h"
+
+/**
+ * pingpong延迟测试：每个会话只有一条消息在途，延迟即单次往返时间。
+ * 用法：PingPongBench [服务器线程数] [客户端线程数] [会话数] [消息长度] [在途消息数] [秒数]
+ */
+int main(int argc, char *argv[])
+{
+    EchoBenchOptions opt = {0, 1, 1, 64, 1, 5};
+    return runEchoBench("pingpong", opt, argc, argv);
+}
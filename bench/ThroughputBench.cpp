@@ -0,0 +1,11 @@
+#include "BenchCommon.h"
+
+/**
+ * 批量吞吐测试：每个会话保持多条大消息在途，测量回显的MB/s，延迟中包含排队时间。
+ * 用法：ThroughputBench [服务器线程数] [客户端线程数] [会话数] [消息长度] [在途消息数] [秒数]
+ */
+int main(int argc, char *argv[])
+{
+    EchoBenchOptions opt = {2, 2, 8, 16384, 8, 5};
+    return runEchoBench("throughput", opt, argc, argv);
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "muduo_rebuild/TcpServer.h"
+#include "muduo_rebuild/TcpClient.h"
+#include "muduo_rebuild/EventLoop.h"
+#include "muduo_rebuild/EventLoopThread.h"
+#include "muduo_rebuild/TimerId.h"
+#include "muduo_rebuild/TcpConnection.h"
+#include "muduo_rebuild/InetAddress.h"
+#include "muduo_rebuild/Logger.h"
+
+using namespace std::placeholders;
+
+/**
+ * 同一台机器上Unix域套接字与TCP回环的pingpong对比：
+ * 服务器在主线程中回显，客户端在单独的IO线程中维持sessions条连接，
+ * 每条连接上始终只有一条size字节的消息在途，统计seconds秒内完成的往返次数。
+ * 用法：UnixSocketBench [sessions] [size] [seconds]
+ */
+class PingPongClient : noncopyable
+{
+public:
+    PingPongClient(EventLoop *loop, const InetAddress &serverAddr, int sessions, size_t size)
+        : loop_(loop),
+          message_(size, 'x'),
+          messages_(0),
+          counting_(false)
+    {
+        for (int i = 0; i < sessions; ++i)
+        {
+            clients_.push_back(std::make_unique<TcpClient>(loop, serverAddr, "pingpong"));
+            clients_.back()->setConnectionCallback(std::bind(&PingPongClient::onConnection, this, _1));
+            clients_.back()->setMessageCallback(std::bind(&PingPongClient::onMessage, this, _1, _2, _3));
+            clients_.back()->connect();
+        }
+    }
+    void startCounting() { counting_ = true; }
+    int64_t messages() const { return messages_; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            conn->send(message_);
+        }
+    }
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        while (buf->readableBytes() >= message_.size())
+        {
+            buf->retrieve(message_.size());
+            if (counting_)
+            {
+                messages_++;
+            }
+            conn->send(message_);
+        }
+    }
+
+    EventLoop *loop_;
+    const std::string message_;
+    int64_t messages_;
+    bool counting_;
+    std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+static void onServerConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+static void onEcho(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+static void runBench(const char *transport, const InetAddress &listenAddr, int sessions, size_t size, double seconds)
+{
+    EventLoop loop;
+    TcpServer server(&loop, listenAddr);
+    server.setConnectionCallback(onServerConnection);
+    server.setMessageCallback(onEcho);
+    server.start();
+
+    EventLoopThread clientThread;
+    EventLoop *clientLoop = clientThread.startLoop();
+    PingPongClient client(clientLoop, listenAddr, sessions, size);
+    int64_t messages = 0;
+    clientLoop->runAfter(0.5, std::bind(&PingPongClient::startCounting, &client)); // 预热，等待所有连接建立
+    clientLoop->runAfter(0.5 + seconds, [&]()
+                         {
+                             messages = client.messages();
+                             loop.quit(); });
+    loop.loop();
+
+    double msgsPerSec = static_cast<double>(messages) / seconds;
+    printf("{\"bench\":\"unix_vs_tcp\",\"transport\":\"%s\",\"sessions\":%d,\"size\":%zu,"
+           "\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.2f}\n",
+           transport, sessions, size, msgsPerSec, msgsPerSec * static_cast<double>(size) / (1024 * 1024));
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int sessions = argc > 1 ? atoi(argv[1]) : 16;
+    size_t size = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 64;
+    double seconds = argc > 3 ? atof(argv[3]) : 3;
+
+    runBench("tcp", InetAddress(static_cast<uint16_t>(19981)), sessions, size, seconds);
+    std::string path = "/tmp/muduo_rebuild_bench." + std::to_string(getpid());
+    runBench("unix", InetAddress::fromUnixPath(path), sessions, size, seconds);
+    ::unlink(path.c_str());
+    return 0;
+}